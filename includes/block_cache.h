@@ -0,0 +1,58 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Predecoded basic blocks for code running from read-only (PRG-ROM) pages.
+// A block is decoded once from the page pointer and replayed by cpu_execute()
+// without fetching or decoding through the bus. Blocks never cross a 256-byte
+// page, so remapping a page (bank switch) only drops the blocks that start in it.
+
+#define BLOCK_CACHE_SIZE 4096  // Direct-mapped on PC, must be a power of two
+#define BLOCK_MAX_INSNS  16
+
+typedef struct {
+    uint8_t opcode;     // Index into opcode_table (operation, mode, cycles)
+    uint8_t mode;       // Effective-address kind
+    uint16_t operand;   // Zero page / absolute address, pointer, or branch target
+    uint16_t next_pc;   // PC after the instruction
+} DecodedInsn;
+
+typedef struct Block {
+    uint16_t start_pc;
+    bool valid;         // Decoded for start_pc (false = empty slot)
+    uint8_t count;      // 0 = not cacheable (JAM, or straddles the page end):
+                        // the lookup hands it to the interpreter without decoding again
+    DecodedInsn insn[BLOCK_MAX_INSNS];
+
+    // Native code (CPU_JIT builds), reset whenever the block is rebuilt
+    void *native;
+    uint8_t native_count;   // Instructions covered by the native code
+    uint8_t native_state;   // JIT_* in jit.h
+    uint16_t native_guard;  // Worst-case cycles before the last native instruction
+    uint16_t heat;          // Interpreted runs, compiled once it gets hot
+} Block;
+
+typedef struct BlockCache {
+    Block blocks[BLOCK_CACHE_SIZE];
+
+    // Stats
+    uint64_t hits;
+    uint64_t builds;
+    uint64_t invalidations;
+} BlockCache;
+
+struct CPU;
+
+BlockCache *block_cache_create(void);
+void block_cache_destroy(BlockCache *cache);
+
+// Block starting at pc, decoded on a miss. NULL if pc is not in a read-only page
+// or no instruction can be cached there.
+Block *block_cache_lookup(BlockCache *cache, struct CPU *nes, uint16_t pc);
+
+// Bank switch: drop every block starting in the given pages
+void block_cache_invalidate(BlockCache *cache, uint8_t first_page, int page_count);
+
+#endif
@@ -4,14 +4,75 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ppu.h"
+#include "scheduler.h"
 
+// Status flags
+#define FLAG_C 0x01
+#define FLAG_Z 0x02
+#define FLAG_I 0x04
+#define FLAG_D 0x08
+#define FLAG_B 0x10
+#define FLAG_U 0x20
+#define FLAG_V 0x40
+#define FLAG_N 0x80
+
+struct Trace;
+struct BlockCache;
+struct Jit;
+struct CPU;
+
+// === Memory map ===
+#define CPU_PAGE_SHIFT 8
+#define CPU_PAGE_COUNT 256  // 256-byte pages
+
+typedef uint8_t (*CpuReadHandler)(struct CPU *nes, uint16_t addr);
+typedef void (*CpuWriteHandler)(struct CPU *nes, uint16_t addr, uint8_t value);
+typedef void (*CpuWatchCallback)(struct CPU *nes, uint16_t addr, uint8_t value, bool write);
+
+// === Idle loops ===
+#define IDLE_LOOP_MAX_BYTES 16
+
+// Polling loop found by cpu_idle_loop (LDA $2002 / BPL, LDA flag / BEQ, JMP *)
 typedef struct {
+    bool armed;
+    int32_t rejected;     // Last head found impure, -1 if none
+    uint16_t head;        // First instruction
+    uint16_t closer;      // Branch/JMP back to head
+    uint8_t count;        // Instructions per iteration
+    uint8_t tail;         // Cycles of the closing branch/JMP
+    uint16_t iteration;   // Cycles per iteration
+
+    // CPU state the last time the head was reached
+    uint8_t a, x, y, p, sp;
+    uint64_t cycles;
+    int executed;
+} IdleLoop;
+
+typedef struct {
+    uint64_t cycles;
+    int instructions;
+} IdleSkip;
+
+typedef struct CPU {
     // == Memory ==
     uint8_t ram[2048];      // RAM (2 KB)
     uint8_t prg_rom[32768]; // PRG-ROM (max 32 KB)
 
     uint8_t prg_banks;
 
+    // == Memory map (see cpu_map_memory / cpu_map_io) ==
+    uint8_t *read_map[CPU_PAGE_COUNT];           // Direct page pointer, NULL = handler
+    uint8_t *write_map[CPU_PAGE_COUNT];
+    CpuReadHandler read_handler[CPU_PAGE_COUNT];
+    CpuWriteHandler write_handler[CPU_PAGE_COUNT];
+
+    uint8_t *mapped_read[CPU_PAGE_COUNT];        // Mapping before watchpoints are applied
+    uint8_t *mapped_write[CPU_PAGE_COUNT];
+    CpuReadHandler io_read[CPU_PAGE_COUNT];
+    CpuWriteHandler io_write[CPU_PAGE_COUNT];
+    bool page_watched[CPU_PAGE_COUNT];
+    CpuWatchCallback watch_callback;
+
     // == CPU Registers ==
     uint8_t A;   // Accumulateur
     uint8_t X;   // Registre X
@@ -26,10 +87,26 @@ typedef struct {
 
     uint8_t key[8]; // 8 buttons : A, B, Select, Start, Up, Down, Left, Right
 
+    // Controller 1: `key` is the live frontend state, sampled once per frame into
+    // `controller` (bit 0 = A ... bit 7 = Right), which the $4016 strobe latches
+    uint8_t controller;
+    uint8_t controller_shift;
+    bool controller_strobe;
+
     PPU *ppu;
     uint64_t cycles;
-    bool nmi_pending;
-    
+    uint64_t ppu_cycles;  // CPU cycles already mirrored on the PPU (batch API)
+    Scheduler scheduler;  // Next event of each component, bounds the CPU bursts
+    bool nmi_pending;     // Latched by cpu_nmi, taken by the cores between instructions
+
+    struct Trace *trace;  // Binary CPU trace (CPU_TRACE builds only), NULL if off
+    struct BlockCache *block_cache;  // Predecoded PRG-ROM blocks, NULL if off
+    struct Jit *jit;  // Native code for hot blocks (CPU_JIT builds only), NULL if off
+
+    bool idle_skip;         // Fast-forward idle loops (on by default, off while tracing)
+    IdleLoop idle;
+    uint64_t idle_skipped;  // Cycles fast-forwarded, for stats
+
     bool draw_flag;
 } CPU;
 
@@ -40,8 +117,78 @@ int load_program(CPU *nes, const char *filename);
 void nes_write(CPU *nes, uint16_t addr, uint8_t value);
 uint8_t nes_read(CPU *nes, uint16_t addr);
 
-void nes_emulation_cycle(CPU *nes);
+// Fast path shared by the CPU cores: one indexed load for mapped pages
+static inline uint8_t cpu_bus_read(CPU *nes, uint16_t addr) {
+    const uint8_t *page = nes->read_map[addr >> CPU_PAGE_SHIFT];
+    if (page) {
+        return page[addr & 0xFF];
+    }
+    return nes->read_handler[addr >> CPU_PAGE_SHIFT](nes, addr);
+}
+
+static inline void cpu_bus_write(CPU *nes, uint16_t addr, uint8_t value) {
+    uint8_t *page = nes->write_map[addr >> CPU_PAGE_SHIFT];
+    if (page) {
+        page[addr & 0xFF] = value;
+    } else {
+        nes->write_handler[addr >> CPU_PAGE_SHIFT](nes, addr, value);
+    }
+}
+
+// Memory map: mappers swap page pointers on bank switches, debuggers watch pages
+void cpu_map_memory(CPU *nes, uint8_t first_page, int page_count, uint8_t *read, uint8_t *write);
+void cpu_map_io(CPU *nes, uint8_t first_page, int page_count, CpuReadHandler read, CpuWriteHandler write);
+void cpu_map_prg_rom(CPU *nes);
+void cpu_watch_page(CPU *nes, uint8_t page, bool watched);
+
+// Reference core: execute one instruction, returns the CPU cycles spent
+int nes_emulation_cycle(CPU *nes);
+
+// Build-selected core (switch by default, threaded with CPU_CORE_THREADED):
+// run instructions until at least cycle_budget cycles are spent, returns the
+// number of instructions executed. Cycles are accumulated in CPU::cycles.
+int cpu_execute(CPU *nes, int cycle_budget);
+
+// Predecoded basic blocks for PRG-ROM code (reference core only)
+void cpu_enable_block_cache(CPU *nes, bool enabled);
 
+// x86-64 recompiler on top of the block cache (enables it). Returns false if
+// this build has no JIT.
+bool cpu_enable_jit(CPU *nes, bool enabled);
+
+// Called by the cores when a taken branch/JMP at `from` lands back on nes->PC
+// (registers in nes are current, `now` is the cycle count). Once an iteration
+// ends in the exact state it started in, every following iteration up to `end`
+// is skipped in one jump. Run cpu_execute with budgets that end at the next
+// PPU event to make the most of it.
+IdleSkip cpu_idle_loop(CPU *nes, uint16_t from, uint64_t now, uint64_t end, int executed);
+
+// NMI line: cpu_nmi latches it (nmi_pending), the cores call cpu_take_nmi
+// between two instructions with the registers in CPU up to date
 void cpu_nmi(CPU *cpu);
+void cpu_take_nmi(CPU *cpu);
+
+// === Batch execution ===
+// CPU and PPU in one tight loop, the CPU running up to each PPU event.
+// nes_run_frame returns once the PPU has a new frame (draw_flag set, cleared on
+// entry) and samples the input first, nes_run_cycles once at least `cycles`
+// CPU cycles have run. Both return the CPU cycles actually spent.
+uint64_t nes_run_frame(CPU *nes);
+uint64_t nes_run_cycles(CPU *nes, uint64_t cycles);
+
+// Bring the PPU up to CPU::cycles (PPU register accesses do it on their own).
+// Drivers running cpu_execute themselves must stop at scheduler_next and call
+// scheduler_run_due, which syncs the PPU on its events.
+void nes_sync_ppu(CPU *nes);
+
+// (Re)arm SCHED_PPU at the PPU's next event, after its state changed
+void nes_schedule_ppu(CPU *nes);
+
+// Accuracy tier for the loaded ROM: PPU specialization + CPU settings (the
+// accurate tier also runs idle loops for real, since sprite 0 is not an event)
+void nes_set_tier(CPU *nes, PpuTier tier);
+
+// Snapshot `key` into the controller state the game reads through $4016
+void nes_sample_input(CPU *nes);
 
 #endif
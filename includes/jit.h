@@ -0,0 +1,53 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// x86-64 dynamic recompiler for hot PRG-ROM blocks (make JIT=1 / -DCPU_JIT).
+// Works on top of the block cache: once a block has been interpreted
+// JIT_HOT_THRESHOLD times, its longest supported prefix is translated to native
+// code. N/Z are evaluated lazily from the last result byte. Accesses that can
+// reach $2000-$401F or non-RAM pages go through the bus like the interpreter,
+// and code in RAM is never compiled. Results are identical to the reference core.
+
+#define JIT_HOT_THRESHOLD 8
+#define JIT_CODE_SIZE     (4 * 1024 * 1024)
+
+enum {
+    JIT_NONE = 0,   // Not tried yet
+    JIT_NATIVE,     // Block->native is valid
+    JIT_REJECTED    // First instruction unsupported, stay interpreted
+};
+
+typedef struct Jit {
+    uint8_t *code;      // RWX buffer, bump allocated
+    size_t used;
+
+    // Stats
+    uint64_t compiled;
+    uint64_t native_runs;
+    uint64_t flushes;
+} Jit;
+
+struct CPU;
+struct Block;
+
+#if defined(CPU_JIT) && defined(__x86_64__)
+#define JIT_AVAILABLE 1
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+Jit *jit_create(void);
+void jit_destroy(Jit *jit);
+
+// Drop all native code (RAM mapping or watchpoints changed)
+void jit_flush(Jit *jit, struct CPU *nes);
+
+// Run the block natively if it is (or just became) compiled and the whole native
+// prefix fits before `end`. Returns the instructions executed, 0 = interpret it.
+int jit_run_block(Jit *jit, struct CPU *nes, struct Block *block, uint64_t end);
+
+#endif
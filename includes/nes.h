@@ -0,0 +1,23 @@
+#ifndef NES_H
+#define NES_H
+
+#include "cpu.h"
+#include "ppu.h"
+
+// One emulated console: owns its components and wires them together through
+// pointers and callbacks that carry their context, with no global state, so a
+// process can host any number of them (one per worker thread). The APU and
+// mappers join here the same way when they exist.
+typedef struct NES {
+    CPU cpu;
+    PPU ppu;
+} NES;
+
+// Allocates and initializes a console with no ROM, NULL if out of memory
+NES *nes_create(void);
+void nes_destroy(NES *nes);
+
+// Load an iNES file, 0 on success
+int nes_load(NES *nes, const char *filename);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <stdint.h>
+
+// === Addressing modes ===
+typedef enum {
+    AM_IMP,  // Implied
+    AM_ACC,  // Accumulator
+    AM_IMM,  // #$nn
+    AM_ZP,   // $nn
+    AM_ZPX,  // $nn,X
+    AM_ZPY,  // $nn,Y
+    AM_ABS,  // $nnnn
+    AM_ABX,  // $nnnn,X
+    AM_ABY,  // $nnnn,Y
+    AM_IND,  // ($nnnn) - JMP only
+    AM_IZX,  // ($nn,X)
+    AM_IZY,  // ($nn),Y
+    AM_REL,  // Branch offset
+    AM_COUNT
+} AddrMode;
+
+// === Operations ===
+typedef enum {
+    // Official
+    OP_ADC, OP_AND, OP_ASL, OP_BCC, OP_BCS, OP_BEQ, OP_BIT, OP_BMI,
+    OP_BNE, OP_BPL, OP_BRK, OP_BVC, OP_BVS, OP_CLC, OP_CLD, OP_CLI,
+    OP_CLV, OP_CMP, OP_CPX, OP_CPY, OP_DEC, OP_DEX, OP_DEY, OP_EOR,
+    OP_INC, OP_INX, OP_INY, OP_JMP, OP_JSR, OP_LDA, OP_LDX, OP_LDY,
+    OP_LSR, OP_NOP, OP_ORA, OP_PHA, OP_PHP, OP_PLA, OP_PLP, OP_ROL,
+    OP_ROR, OP_RTI, OP_RTS, OP_SBC, OP_SEC, OP_SED, OP_SEI, OP_STA,
+    OP_STX, OP_STY, OP_TAX, OP_TAY, OP_TSX, OP_TXA, OP_TXS, OP_TYA,
+
+    // Illegal
+    OP_ALR, OP_ANC, OP_ARR, OP_DCP, OP_ISC, OP_JAM, OP_LAS, OP_LAX,
+    OP_RLA, OP_RRA, OP_SAX, OP_SBX, OP_SHA, OP_SHX, OP_SHY, OP_SLO,
+    OP_SRE, OP_TAS, OP_XAA,
+    OP_COUNT
+} Operation;
+
+typedef struct {
+    const char *name;      // Mnemonic
+    uint8_t op;            // Operation
+    uint8_t mode;          // AddrMode
+    uint8_t cycles;        // Base cycle count
+    uint8_t page_penalty;  // +1 cycle when indexing crosses a page
+} Opcode;
+
+extern const Opcode opcode_table[256];
+extern const uint8_t addr_mode_size[AM_COUNT];  // Operand bytes after the opcode
+
+#endif
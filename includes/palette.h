@@ -0,0 +1,35 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+
+// NES colors -> ARGB8888 for the frontends.
+// The LUT has 512 entries: 8 emphasis combinations (PPUMASK bits 5-7, >> 5)
+// x 64 colors, a line drawn with emphasis e converts through argb[e * 64].
+// palette_build_lut also picks the AVX2, SSSE3 or scalar kernel that
+// palette_convert_line runs with it, from what the host CPU supports.
+
+#define PALETTE_COLORS   64
+#define PALETTE_EMPHASIS 8
+
+extern const uint32_t NES_PALETTE[PALETTE_COLORS];
+
+struct PaletteLut;
+
+typedef void (*PaletteKernel)(const struct PaletteLut *lut, uint8_t emphasis, uint32_t *dst, const uint8_t *src, int count);
+
+typedef struct PaletteLut {
+    uint32_t argb[PALETTE_EMPHASIS * PALETTE_COLORS];
+    // Same table for pshufb: byte B, G, R of the colors, 16 at a time
+    uint8_t planes[PALETTE_EMPHASIS][3][PALETTE_COLORS / 16][16];
+
+    PaletteKernel kernel;
+    const char *kernel_name;  // "avx2", "ssse3" or "scalar"
+} PaletteLut;
+
+void palette_build_lut(PaletteLut *lut);
+
+// `count` pixels of 6-bit color indices (upper bits ignored) to ARGB
+void palette_convert_line(const PaletteLut *lut, uint8_t emphasis, uint32_t *dst, const uint8_t *src, int count);
+
+#endif
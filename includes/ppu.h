@@ -3,11 +3,27 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "palette.h"
 
 #define SCREEN_WIDTH  256
 #define SCREEN_HEIGHT 240
 
 #define TILE_SIZE 8 // 8x8
+#define PPU_PATTERN_TILES 512  // 2 pattern tables x 256 tiles
+#define PPU_NAMETABLES 2        // Physical nametables in vram (the other two are mirrors)
+#define PPU_NAMETABLE_COLS 32
+#define PPU_NAMETABLE_ROWS 30
+#define PPU_SPRITES 64
+#define PPU_SPRITES_PER_LINE 8
+
+// OAM entry: Y, tile, attributes, X
+#define SPRITE_ATTR_PALETTE   0x03
+#define SPRITE_ATTR_BEHIND_BG 0x20
+#define SPRITE_ATTR_FLIP_X    0x40
+#define SPRITE_ATTR_FLIP_Y    0x80
+
+#define PPU_DOTS_PER_LINE   341
+#define PPU_LINES_PER_FRAME 262  // Pre-render (-1) to 260
 
 #define PPU_PATTERN_TABLE_0  0x0000  // Pattern table 0 (sprites)
 #define PPU_PATTERN_TABLE_1  0x1000  // Pattern table 1 (background)
@@ -38,37 +54,133 @@
 #define PPUMASK_SHOW_SPRITES  0x10
 #define PPUMASK_SHOW_LEFT_BG  0x02
 #define PPUMASK_SHOW_LEFT_SPR 0x04
+#define PPUMASK_GRAYSCALE     0x01
+#define PPUMASK_EMPHASIS      0xE0  // Red, green, blue
+#define PPUMASK_EMPHASIS_SHIFT 5
 
 // Flags PPUSTATUS ($2002)
 #define PPUSTATUS_VBLANK      0x80
 #define PPUSTATUS_SPRITE_0    0x40
 #define PPUSTATUS_SPRITE_OVERFLOW 0x20
 
+// === Instrumentation ===
+// Per-region access counters and sampled logging, compiled in with -DPPU_STATS
+// (make PPU_STATS=1). Release builds keep the struct but never touch it.
+typedef enum {
+    PPU_REGION_PATTERN,    // $0000-$1FFF
+    PPU_REGION_NAMETABLE,  // $2000-$3EFF, tiles
+    PPU_REGION_ATTRIBUTE,  // $23C0-$23FF & co
+    PPU_REGION_PALETTE,    // $3F00-$3FFF
+    PPU_REGION_COUNT
+} PpuRegion;
+
+typedef struct {
+    uint64_t reads[PPU_REGION_COUNT];
+    uint64_t writes[PPU_REGION_COUNT];
+    uint32_t log_every;  // Print one access out of N, 0 = off
+    uint32_t log_countdown;
+} PpuStats;
+
+// === Accuracy tiers ===
+// Picked per ROM with ppu_set_tier (nes_set_tier for the whole machine), each
+// one a separate specialization of the PPU loop behind a function table.
+typedef enum {
+    PPU_TIER_FAST,      // Scanline renderer + event catch-up (default)
+    PPU_TIER_ACCURATE,  // Dot-based fetch pipeline, mid-scanline effects
+    PPU_TIER_COUNT
+} PpuTier;
+
+struct PPU;
+
+// Raised at the start of vblank when PPUCTRL enables it, with the context
+// given to ppu_set_nmi_callback
+typedef void (*PpuNmiCallback)(void *context);
+
+typedef struct {
+    const char *name;
+    void (*run)(struct PPU *ppu, int dots);
+    int (*dots_until_event)(struct PPU *ppu);
+} PpuTierOps;
+
+// Scroll of one scanline for the fast tier: loopy v (NN YYYYY XXXXX + fine Y)
+// and fine x as they were when the line started
 typedef struct {
+    uint16_t v;
+    uint8_t fine_x;
+} PpuScroll;
+
+typedef struct PPU {
     uint8_t chr_rom[8192];  // CHR-ROM (Pattern Memory) 0x0000 - 0x1FFF (Sprites)
     bool chr_ram_enabled;
 
+    // Decoded CHR: byte x of pattern_cache[tile][row] is pixel x (0-3).
+    // A tile is decoded on first use after ppu_invalidate_patterns marks it dirty.
+    uint64_t pattern_cache[PPU_PATTERN_TILES][TILE_SIZE];
+    uint8_t pattern_opacity[PPU_PATTERN_TILES][TILE_SIZE];  // Bit 7-x set if pixel x is opaque
+    bool pattern_dirty[PPU_PATTERN_TILES];
+
     uint8_t vram[2048];  // VRAM (Name Table Memory) 0x2000 - 0x27FF (Layout)
+
+    // Background pre-rendered per physical nametable: palette RAM index (0-15,
+    // 0 = backdrop) of every pixel. Cells are re-rendered when dirty, scanlines
+    // are blits from here.
+    uint8_t bg_layer[PPU_NAMETABLES][SCREEN_HEIGHT][SCREEN_WIDTH];
+    bool bg_dirty[PPU_NAMETABLES][PPU_NAMETABLE_ROWS][PPU_NAMETABLE_COLS];
+    bool bg_stale;                // Every cell dirty (CHR reloaded)
+    // CHR-RAM tiles rewritten since the last blit: only the cells showing one
+    // of them are redrawn, found in one pass over the nametables
+    bool bg_tile_changed[PPU_PATTERN_TILES];
+    bool bg_tiles_changed;
+    uint16_t bg_pattern_base;     // Pattern table the layers were drawn with
     uint8_t palette[32];  // Palette Memory 0x3F00 - 0x3F1F (Colors)
     uint8_t oam[256];  // Object Attribute Memory (sprites)
 
+    // Sprites on each line, first 8 in OAM order, rebuilt in one pass over OAM
+    // when it (or the sprite size) changed since the last build
+    uint8_t sprite_lines[SCREEN_HEIGHT][PPU_SPRITES_PER_LINE];
+    uint8_t sprite_line_count[SCREEN_HEIGHT];
+    bool sprite_line_overflow[SCREEN_HEIGHT];
+    bool sprites_dirty;
+    uint8_t sprite_height;  // Height the lists were built for
+    int16_t sprite0_dot;    // Dot of this line's sprite 0 hit, -1 if none
+
     // === Registres PPU ($2000-$2007) ===
     uint8_t ctrl;               // $2000 - PPUCTRL
     uint8_t mask;               // $2001 - PPUMASK
     uint8_t status;             // $2002 - PPUSTATUS
     uint8_t oam_addr;           // $2003 - OAMADDR
-    int8_t scroll_x;            // $2005 - PPUSCROLL X
-    uint8_t scroll_y;           // $2005 - PPUSCROLL Y
     uint16_t addr;              // $2006 - PPUADDR (16-bit)
     uint8_t data;               // $2007 - PPUDATA
 
+    // Loopy registers: addr = v, temp_addr = t, fine_x = x, addr_latch = w
     bool addr_latch;
     uint8_t data_buffer;
     uint16_t temp_addr;
     uint8_t fine_x;
 
+    // Fast tier: scroll snapshot of each visible line, taken at its start (or
+    // before the first register write that would change it mid-line)
+    PpuScroll line_scroll[SCREEN_HEIGHT];
+    int16_t scroll_line;  // Last line snapshotted, -1 if none
+
+    // Accurate tier: background shift registers and the tile being fetched
+    uint16_t bg_shift_lo, bg_shift_hi;
+    uint16_t at_shift_lo, at_shift_hi;
+    uint8_t next_tile, next_attrib, next_lo, next_hi;
+    uint8_t line_indices[SCREEN_WIDTH + TILE_SIZE];
+    uint8_t sprite0_mask;   // Sprite 0 pixels that can still hit on this line
+    int16_t sprite0_x;
+
     // === Framebuffer ===
+    // One 6-bit NES color (palette.h index) per pixel, and for each line the
+    // PPUMASK emphasis bits (>> 5) it was drawn with: line y converts through
+    // argb[line_emphasis[y] * 64 + color]. After ppu_set_output_argb lines
+    // go straight to the caller's ARGB buffer and framebuffer is left alone.
     uint8_t framebuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint8_t line_emphasis[SCREEN_HEIGHT];
+    uint32_t *output_argb;
+    int output_pitch;  // Bytes per line of output_argb
+    const PaletteLut *output_palette;
     bool draw_flag;
 
     // === State ===
@@ -77,7 +189,12 @@ typedef struct {
 
     uint64_t frame_count;
 
-    void (*nmi_callback)(void);
+    PpuNmiCallback nmi_callback;
+    void *nmi_context;  // Passed back to nmi_callback (the NES's CPU)
+
+    const PpuTierOps *tier;
+
+    PpuStats stats;  // PPU_STATS builds only
 
 } PPU;
 
@@ -93,17 +210,46 @@ uint8_t ppu_read_register(PPU *ppu, uint16_t addr);
 void ppu_write_memory(PPU *ppu, uint16_t addr, uint8_t value);
 uint8_t ppu_read_memory(PPU *ppu, uint16_t addr);
 
+// OAM DMA ($4014): 256 bytes copied from OAMADDR on
+void ppu_oam_dma(PPU *ppu, const uint8_t *data);
+
+// Call after changing chr_rom behind the PPU's back (ROM load, CHR bank switch):
+// the decoded tiles covering [addr, addr + length) are rebuilt on next use
+void ppu_invalidate_patterns(PPU *ppu, uint16_t addr, uint16_t length);
+
 // === Frame ===
 void ppu_render_scanline(PPU *ppu);
 
 // === PPU Cycle ===
 void ppu_step(PPU *ppu);        // Exécuter un cycle PPU
 
+// Catch-up: advance `dots` dots through the current tier. The fast tier jumps
+// straight from one event to the next, same result as ppu_step `dots` times.
+void ppu_run(PPU *ppu, int dots);
+void ppu_set_tier(PPU *ppu, PpuTier tier);
+
+// Dots until the next one that must not run behind the CPU's back. Fast tier:
+// vblank set (+ NMI) / clear, pre-render v = t, scanline render, and on lines
+// covered by sprite 0 the hit check at dot 1 + the hit itself. Accurate tier: vblank set only,
+// flags are caught up by $2002 reads. Always >= 1.
+int ppu_dots_until_event(PPU *ppu);
+
+// === Output ===
+// Render into `pixels` (ARGB8888, 240 lines of `pitch` bytes) through `palette`
+// instead of the framebuffer, until called again with pixels = NULL
+void ppu_set_output_argb(PPU *ppu, uint32_t *pixels, int pitch, const PaletteLut *palette);
+
 // === Callbacks NMI ===
-void ppu_set_nmi_callback(PPU *ppu, void (*callback)(void));
+void ppu_set_nmi_callback(PPU *ppu, PpuNmiCallback callback, void *context);
 
 // === Debug ===
 void ppu_dump_palette(PPU *ppu);
 void ppu_dump_oam(PPU *ppu);
 
+// === Instrumentation ===
+PpuRegion ppu_region(uint16_t addr);
+const char *ppu_region_name(PpuRegion region);
+void ppu_stats_reset(PPU *ppu);
+void ppu_dump_stats(PPU *ppu);
+
 #endif
@@ -0,0 +1,55 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Timing scheduler: every component that changes something the CPU can observe
+// registers the cycle of its next event. The CPU runs in bursts up to the
+// earliest one (scheduler_next), then scheduler_run_due calls the handlers that
+// are due, which re-arm themselves. Times are absolute CPU cycles (CPU::cycles),
+// the master clock of the batch loop; PPU dots are converted by their owner.
+// Each id is scheduled at most once: an indexed min-heap of SCHED_EVENT_COUNT.
+
+typedef enum {
+    SCHED_PPU,          // Next PPU event (vblank, NMI, scanline, sprite 0)
+    SCHED_APU_FRAME,    // APU frame counter (no APU yet)
+    SCHED_MAPPER_IRQ,   // Mapper IRQ counter (no IRQ mapper yet)
+    SCHED_EVENT_COUNT
+} SchedEventId;
+
+struct CPU;
+
+typedef void (*SchedHandler)(struct CPU *nes, uint64_t time);
+
+typedef struct {
+    uint64_t time;
+    uint8_t id;
+} SchedEntry;
+
+typedef struct Scheduler {
+    SchedEntry heap[SCHED_EVENT_COUNT];
+    int count;
+    int8_t slot[SCHED_EVENT_COUNT];  // Heap index of each id, -1 if not scheduled
+    SchedHandler handler[SCHED_EVENT_COUNT];
+
+    // Stats
+    uint64_t dispatched;
+} Scheduler;
+
+void scheduler_init(Scheduler *sched);
+void scheduler_set_handler(Scheduler *sched, SchedEventId id, SchedHandler handler);
+
+// Insert id at `time`, or move it there if it is already scheduled
+void scheduler_schedule(Scheduler *sched, SchedEventId id, uint64_t time);
+void scheduler_cancel(Scheduler *sched, SchedEventId id);
+
+// Run the handler of every event due at `now`, earliest first
+void scheduler_run_due(Scheduler *sched, struct CPU *nes, uint64_t now);
+
+// Cycle of the earliest event, UINT64_MAX if none
+static inline uint64_t scheduler_next(const Scheduler *sched) {
+    return sched->count ? sched->heap[0].time : UINT64_MAX;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Binary CPU trace.
+// Build with -DCPU_TRACE (make TRACE=1) to enable it, otherwise the hook in the
+// CPU core compiles to nothing. Records go into a single-producer/single-consumer
+// ring buffer that a writer thread drains to disk. bin/trace2text turns the file
+// back into nestest-style text.
+
+#define TRACE_MAGIC     "NESTRACE"
+#define TRACE_VERSION   1
+#define TRACE_RING_SIZE (1 << 16)  // Records, must be a power of two
+
+// One executed instruction, state before execution
+typedef struct {
+    uint64_t cycle;
+    uint16_t pc;
+    uint8_t opcode;
+    uint8_t operand[2];
+    uint8_t a, x, y, p, sp;
+    uint8_t reserved[3];
+} TraceRecord;  // 24 bytes
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} TraceHeader;
+
+typedef struct Trace {
+    TraceRecord *ring;
+    _Atomic uint64_t head;  // Written by the emulation thread
+    _Atomic uint64_t tail;  // Written by the writer thread
+    _Atomic bool running;
+
+    FILE *file;
+    pthread_t writer;
+    uint64_t stalls;        // Times the producer waited on a full ring
+} Trace;
+
+int trace_open(Trace *trace, const char *path);
+void trace_close(Trace *trace);
+
+void trace_wait_for_space(Trace *trace);
+
+// Hot path: one store into the ring, no syscalls
+static inline void trace_push(Trace *trace, const TraceRecord *record) {
+    uint64_t head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&trace->tail, memory_order_acquire) >= TRACE_RING_SIZE) {
+        trace_wait_for_space(trace);
+    }
+    trace->ring[head & (TRACE_RING_SIZE - 1)] = *record;
+    atomic_store_explicit(&trace->head, head + 1, memory_order_release);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ppu.h"
+
+// Lock-free triple buffer between the emulation thread (single producer) and
+// the display thread (single consumer). The producer always has a frame to draw
+// into and never waits; the consumer always gets the newest finished frame,
+// older ones are dropped. The only shared state is the index of the middle
+// frame, swapped atomically on each side.
+
+#define TRIPLE_BUFFER_FRESH 0x04  // Middle frame published and not taken yet
+
+// One frame as the PPU outputs it (see PPU::framebuffer)
+typedef struct {
+    uint8_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint8_t emphasis[SCREEN_HEIGHT];
+} Frame;
+
+typedef struct {
+    Frame frames[3];
+    _Atomic uint8_t middle;  // Index of the last published frame | FRESH
+    uint8_t back;            // Producer's frame
+    uint8_t front;           // Consumer's frame
+} TripleBuffer;
+
+void triple_buffer_init(TripleBuffer *buffer);
+
+// Producer: frame to draw into, then publish it (it replaces any frame not
+// taken yet, and a free one becomes the new back frame)
+Frame *triple_buffer_back(TripleBuffer *buffer);
+void triple_buffer_publish(TripleBuffer *buffer);
+
+// Consumer: newest frame if one was published since the last call, else NULL.
+// It stays valid until the next call that returns non-NULL.
+const Frame *triple_buffer_acquire(TripleBuffer *buffer);
+
+#endif
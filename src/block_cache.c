@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../includes/block_cache.h"
+#include "../includes/cpu.h"
+#include "../includes/opcodes.h"
+
+BlockCache *block_cache_create(void) {
+    return calloc(1, sizeof(BlockCache));
+}
+
+void block_cache_destroy(BlockCache *cache) {
+    free(cache);
+}
+
+static bool block_ends_after(uint8_t op) {
+    switch (op) {
+        case OP_BPL: case OP_BMI: case OP_BVC: case OP_BVS:
+        case OP_BCC: case OP_BCS: case OP_BNE: case OP_BEQ:
+        case OP_JMP: case OP_JSR: case OP_RTS: case OP_RTI: case OP_BRK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Decode from the page pointer, stopping at control flow, JAM, or the page end
+static void block_build(Block *block, const uint8_t *page, uint16_t pc) {
+    uint16_t page_base = pc & 0xFF00;
+
+    block->start_pc = pc;
+    block->valid = true;
+    block->count = 0;
+    block->native = NULL;
+    block->native_count = 0;
+    block->native_state = 0;
+    block->heat = 0;
+
+    while (block->count < BLOCK_MAX_INSNS && (pc & 0xFF00) == page_base) {
+        uint8_t offset = pc & 0xFF;
+        uint8_t opcode = page[offset];
+        const Opcode *op = &opcode_table[opcode];
+        int length = 1 + addr_mode_size[op->mode];
+
+        if (op->op == OP_JAM || offset + length > 0x100) {
+            break;
+        }
+
+        DecodedInsn *insn = &block->insn[block->count++];
+        insn->opcode = opcode;
+        insn->mode = op->mode;
+        insn->next_pc = pc + length;
+
+        if (length == 2) {
+            insn->operand = page[offset + 1];
+        } else if (length == 3) {
+            insn->operand = page[offset + 1] | (page[offset + 2] << 8);
+        } else {
+            insn->operand = 0;
+        }
+
+        // Precompute what does not depend on registers
+        if (op->mode == AM_IMM) {
+            insn->operand = pc + 1;
+        } else if (op->mode == AM_REL) {
+            insn->operand = insn->next_pc + (int8_t)insn->operand;
+        }
+
+        pc = insn->next_pc;
+        if (block_ends_after(op->op)) {
+            break;
+        }
+    }
+}
+
+Block *block_cache_lookup(BlockCache *cache, CPU *nes, uint16_t pc) {
+    Block *block = &cache->blocks[pc & (BLOCK_CACHE_SIZE - 1)];
+
+    if (block->valid && block->start_pc == pc) {
+        cache->hits++;
+        return block->count ? block : NULL;
+    }
+
+    // Only code from read-only direct pages can be cached
+    uint8_t page = pc >> CPU_PAGE_SHIFT;
+    if (!nes->read_map[page] || nes->write_map[page]) {
+        return NULL;
+    }
+
+    block_build(block, nes->read_map[page], pc);
+    cache->builds++;
+    return block->count ? block : NULL;
+}
+
+void block_cache_invalidate(BlockCache *cache, uint8_t first_page, int page_count) {
+    for (int i = 0; i < BLOCK_CACHE_SIZE; i++) {
+        Block *block = &cache->blocks[i];
+        uint8_t page = block->start_pc >> CPU_PAGE_SHIFT;
+        if (block->valid && page >= first_page && page < first_page + page_count) {
+            block->valid = false;
+            cache->invalidations++;
+        }
+    }
+}
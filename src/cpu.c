@@ -3,40 +3,10 @@
 Set a flag: nes->P |= flagHEX;
 Clear a flag: nes->P &= ~flagHEX;
 
-=== TYPE ===
-Immediate: nes->ram[nes->PC++];
-
-Zero page: nes->ram[nes->PC++];
-
-Zeropage,X: uint8_t base = nes->ram[nes->PC++];
-            uint8_t addr = (base + nes->X) & 0xFF;
-
-Zeropage,Y: uint8_t base = nes->ram[nes->PC++];
-            uint8_t addr = (base + nes->Y) & 0xFF;
-
-Absolute:   uint16_t addr = nes->ram[nes->PC] | (nes->ram[nes->PC + 1] << 8);
-            nes->PC += 2;
-
-Absolute,X: uint16_t base = nes->ram[nes->PC] | (nes->ram[nes->PC + 1] << 8);
-            nes->PC += 2;
-            uint16_t addr = base + nes->X;
-
-Absolute,Y: uint16_t base = nes->ram[nes->PC] | (nes->ram[nes->PC + 1] << 8);
-            nes->PC += 2;
-            uint16_t addr = base + nes->Y;
-
-Indirect: uint16_t ptr = nes->ram[nes->PC] | (nes->ram[nes->PC + 1] << 8);
-          nes->PC += 2;
-          uint16_t addr = nes->ram[ptr] | (nes->ram[ptr + 1] << 8);
-
-Indexed indirect ($nn,X): uint8_t zp = nes->ram[nes->PC++];
-                          uint16_t addr = nes->ram[(zp + nes->X) & 0xFF] | (nes->ram[(zp + nes->X + 1) & 0xFF] << 8);
-
-Indirect indexed ($nn),Y: uint8_t zp = nes->ram[nes->PC++];
-                          uint16_t base = nes->ram[zp] | (nes->ram[(zp + 1) & 0xFF] << 8);
-                          uint16_t addr = base + nes->Y;
-
-Relative (branch): int8_t offset = nes->ram[nes->PC++];
+=== DECODE ===
+Every opcode is described by opcode_table (src/opcodes.c): operation, addressing mode,
+base cycles and page-cross penalty. nes_emulation_cycle() resolves the effective address
+from the mode, runs the operation and returns the cycles actually spent.
 */
 
 
@@ -44,101 +14,220 @@ Relative (branch): int8_t offset = nes->ram[nes->PC++];
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <time.h>
 #include "../includes/cpu.h"
-
-#define FLAG_C 0x01
-#define FLAG_Z 0x02
-#define FLAG_I 0x04
-#define FLAG_D 0x08
-#define FLAG_B 0x10
-#define FLAG_U 0x20
-#define FLAG_V 0x40
-#define FLAG_N 0x80
+#include "../includes/opcodes.h"
+#include "../includes/block_cache.h"
+#include "../includes/jit.h"
+#ifdef CPU_TRACE
+#include "../includes/trace.h"
+#endif
 
 #define DEBUG_CPU 0
 
-void nes_init(CPU *nes) {
-    memset(nes, 0, sizeof(CPU));
-    nes->SP = 0xFD;
-    memset(nes->gfx, 0, sizeof(nes->gfx));
-    nes->draw_flag = false;
-    srand((unsigned) time(NULL));
+// === Memory map ===
+// The CPU address space is split into 256 pages of 256 bytes. A page is either a
+// direct pointer (RAM, mirrors, PRG-ROM: one indexed load) or a pair of handlers
+// (PPU/APU registers, unmapped areas, watched pages).
+
+static uint8_t cpu_open_bus_read(CPU *nes, uint16_t addr) {
+    (void)nes; (void)addr;
+    return 0;
 }
 
-void cpu_connect_ppu(CPU *cpu, PPU *ppu) {
-    cpu->ppu = ppu;
+static void cpu_ignore_write(CPU *nes, uint16_t addr, uint8_t value) {
+    (void)nes; (void)addr; (void)value;
 }
 
-void nes_write(CPU *nes, uint16_t addr, uint8_t value) {
-    // $0000-$07FF : RAM
-    if (addr < 0x0800) {
-        nes->ram[addr] = value;
+// $2000-$3FFF : PPU registers, mirrored every 8 bytes
+// The PPU lags behind the CPU until something looks at it: catch up first
+static uint8_t cpu_ppu_read(CPU *nes, uint16_t addr) {
+    if (nes->ppu) {
+        nes_sync_ppu(nes);
+        return ppu_read_register(nes->ppu, 0x2000 + (addr & 0x0007));
     }
-    // $0800-$1FFF : Miroirs de la RAM
-    else if (addr < 0x2000) {
-        nes->ram[addr & 0x07FF] = value;
+    return 0;
+}
+
+static void cpu_ppu_write(CPU *nes, uint16_t addr, uint8_t value) {
+    if (nes->ppu) {
+        nes_sync_ppu(nes);
+        ppu_write_register(nes->ppu, 0x2000 + (addr & 0x0007), value);
+        nes_schedule_ppu(nes);  // PPUCTRL/PPUMASK/OAM move the sprite 0 events
     }
-    // $2000-$2007 : Registres PPU
-    else if (addr >= 0x2000 && addr < 0x2008) {
-        if (nes->ppu) {
-            ppu_write_register(nes->ppu, addr, value);
+}
+
+// $4000-$40FF : APU and I/O registers, only OAM DMA and the controller port for now
+static uint8_t cpu_io_read(CPU *nes, uint16_t addr) {
+    switch (addr) {
+        case 0x4016: {
+            // Serial read, A first. Official pads return 1 once the 8 bits are out.
+            uint8_t bit;
+            if (nes->controller_strobe) {
+                bit = nes->controller & 0x01;
+            } else {
+                bit = nes->controller_shift & 0x01;
+                nes->controller_shift = (nes->controller_shift >> 1) | 0x80;
+            }
+            return 0x40 | bit;
         }
+
+        case 0x4017:  // Controller 2: not connected
+            return 0x40;
+
+        default:
+            return 0;
     }
-    // $2008-$3FFF : Miroirs des registres PPU
-    else if (addr < 0x4000) {
-        if (nes->ppu) {
-            ppu_write_register(nes->ppu, 0x2000 + (addr & 0x0007), value);
+}
+
+static void cpu_io_write(CPU *nes, uint16_t addr, uint8_t value) {
+    if (addr == 0x4014) {
+        // OAM DMA from page $XX00, the CPU is stalled for 513 (+1 on odd) cycles
+        uint8_t data[256];
+        for (int i = 0; i < 256; i++) {
+            data[i] = cpu_bus_read(nes, (value << 8) | i);
         }
+        if (nes->ppu) {
+            nes_sync_ppu(nes);
+            ppu_oam_dma(nes->ppu, data);
+            nes_schedule_ppu(nes);
+        }
+        // Straight into CPU::cycles: every core checks it against its budget
+        // after a handler access, so the burst ends here
+        nes->cycles += 513 + (nes->cycles & 1);
+    } else if (addr == 0x4016) {
+        // Strobe high keeps reloading the shift register, the falling edge latches it
+        nes->controller_strobe = value & 0x01;
+        nes->controller_shift = nes->controller;
     }
-    // $4000-$4013, $4015, $4017 : APU
-    else if (addr < 0x4020) {
-        // TODO: APU
-    }
-    // $8000-$FFFF : ROM (read-only)
 }
 
+// Slow path for watched pages: resolve through the real mapping, then notify
+static uint8_t cpu_watch_read(CPU *nes, uint16_t addr) {
+    uint8_t page = addr >> CPU_PAGE_SHIFT;
+    uint8_t value = nes->mapped_read[page]
+                  ? nes->mapped_read[page][addr & 0xFF]
+                  : nes->io_read[page](nes, addr);
+    if (nes->watch_callback) nes->watch_callback(nes, addr, value, false);
+    return value;
+}
 
-uint8_t nes_read(CPU *nes, uint16_t addr) {
-    // $0000-$07FF : RAM (2KB)
-    if (addr < 0x0800) {
-        return nes->ram[addr];
-    }
-    // $0800-$1FFF : Miroirs de la RAM
-    else if (addr < 0x2000) {
-        return nes->ram[addr & 0x07FF];
+static void cpu_watch_write(CPU *nes, uint16_t addr, uint8_t value) {
+    uint8_t page = addr >> CPU_PAGE_SHIFT;
+    if (nes->watch_callback) nes->watch_callback(nes, addr, value, true);
+    if (nes->mapped_write[page]) nes->mapped_write[page][addr & 0xFF] = value;
+    else nes->io_write[page](nes, addr, value);
+}
+
+// Publish the mapping of a page into the lookup tables used by nes_read/nes_write
+static void cpu_update_page(CPU *nes, uint8_t page) {
+    if (nes->page_watched[page]) {
+        nes->read_map[page] = NULL;
+        nes->write_map[page] = NULL;
+        nes->read_handler[page] = cpu_watch_read;
+        nes->write_handler[page] = cpu_watch_write;
+    } else {
+        nes->read_map[page] = nes->mapped_read[page];
+        nes->write_map[page] = nes->mapped_write[page];
+        nes->read_handler[page] = nes->io_read[page];
+        nes->write_handler[page] = nes->io_write[page];
     }
-    // $2000-$2007 : Registres PPU
-    else if (addr >= 0x2000 && addr < 0x2008) {
-        if (nes->ppu) {
-            return ppu_read_register(nes->ppu, addr);
-        }
-        return 0;
+}
+
+void cpu_map_memory(CPU *nes, uint8_t first_page, int page_count, uint8_t *read, uint8_t *write) {
+    for (int i = 0; i < page_count; i++) {
+        uint8_t page = first_page + i;
+        nes->mapped_read[page] = read ? read + (i << CPU_PAGE_SHIFT) : NULL;
+        nes->mapped_write[page] = write ? write + (i << CPU_PAGE_SHIFT) : NULL;
+        cpu_update_page(nes, page);
     }
-    // $2008-$3FFF : Miroirs des registres PPU
-    else if (addr < 0x4000) {
-        if (nes->ppu) {
-            return ppu_read_register(nes->ppu, 0x2000 + (addr & 0x0007));
-        }
-        return 0;
+    if (nes->block_cache) block_cache_invalidate(nes->block_cache, first_page, page_count);
+    if (nes->jit && first_page < 0x20) jit_flush(nes->jit, nes);  // Native code inlines RAM
+}
+
+void cpu_map_io(CPU *nes, uint8_t first_page, int page_count,
+                CpuReadHandler read, CpuWriteHandler write) {
+    for (int i = 0; i < page_count; i++) {
+        uint8_t page = first_page + i;
+        nes->mapped_read[page] = NULL;
+        nes->mapped_write[page] = NULL;
+        nes->io_read[page] = read ? read : cpu_open_bus_read;
+        nes->io_write[page] = write ? write : cpu_ignore_write;
+        cpu_update_page(nes, page);
     }
-    // $4000-$4017 : APU et I/O
-    else if (addr < 0x4020) {
-        return 0;  // TODO
+    if (nes->block_cache) block_cache_invalidate(nes->block_cache, first_page, page_count);
+    if (nes->jit && first_page < 0x20) jit_flush(nes->jit, nes);  // Native code inlines RAM
+}
+
+void cpu_watch_page(CPU *nes, uint8_t page, bool watched) {
+    nes->page_watched[page] = watched;
+    cpu_update_page(nes, page);
+    if (nes->block_cache) block_cache_invalidate(nes->block_cache, page, 1);
+    if (nes->jit) jit_flush(nes->jit, nes);
+}
+
+// $8000-$FFFF : PRG-ROM, a single 16 KB bank is mirrored at $C000
+void cpu_map_prg_rom(CPU *nes) {
+    if (nes->prg_banks == 1) {
+        cpu_map_memory(nes, 0x80, 0x40, nes->prg_rom, NULL);
+        cpu_map_memory(nes, 0xC0, 0x40, nes->prg_rom, NULL);
+    } else {
+        cpu_map_memory(nes, 0x80, 0x80, nes->prg_rom, NULL);
     }
-    // $8000-$FFFF : PRG-ROM
-    else if (addr >= 0x8000) {
-        if (nes->prg_banks == 1)
-            return nes->prg_rom[addr & 0x3FFF];
-        else
-            return nes->prg_rom[addr & 0x7FFF];
+}
+
+static void cpu_memory_map_init(CPU *nes) {
+    // $0000-$1FFF : RAM (2KB) + miroirs
+    for (int mirror = 0; mirror < 4; mirror++) {
+        cpu_map_memory(nes, mirror * 0x08, 0x08, nes->ram, nes->ram);
     }
+    // $2000-$3FFF : Registres PPU + miroirs
+    cpu_map_io(nes, 0x20, 0x20, cpu_ppu_read, cpu_ppu_write);
+    // $4000-$40FF : APU / I/O registers
+    cpu_map_io(nes, 0x40, 0x01, cpu_io_read, cpu_io_write);
+    // $4100-$7FFF : expansion, PRG-RAM (TODO)
+    cpu_map_io(nes, 0x41, 0x3F, NULL, NULL);
+    // $8000-$FFFF : PRG-ROM, read-only until mappers claim the writes
+    cpu_map_io(nes, 0x80, 0x80, NULL, NULL);
+    cpu_map_prg_rom(nes);
+}
 
-    
-    return 0;
+static void nes_ppu_event(CPU *nes, uint64_t time);
+
+void nes_init(CPU *nes) {
+    memset(nes, 0, sizeof(CPU));
+    nes->SP = 0xFD;
+    memset(nes->gfx, 0, sizeof(nes->gfx));
+    nes->draw_flag = false;
+    nes->idle_skip = true;
+    nes->idle.rejected = -1;
+    cpu_memory_map_init(nes);
+
+    scheduler_init(&nes->scheduler);
+    scheduler_set_handler(&nes->scheduler, SCHED_PPU, nes_ppu_event);
+}
+
+void cpu_connect_ppu(CPU *cpu, PPU *ppu) {
+    cpu->ppu = ppu;
 }
 
+void nes_write(CPU *nes, uint16_t addr, uint8_t value) {
+    cpu_bus_write(nes, addr, value);
+}
+
+uint8_t nes_read(CPU *nes, uint16_t addr) {
+    return cpu_bus_read(nes, addr);
+}
+
+// Raised by the PPU from inside a bus access or an event, where a core may
+// still hold the registers in locals (or native registers): only latched here
 void cpu_nmi(CPU *cpu) {
+    cpu->nmi_pending = true;
+}
+
+void cpu_take_nmi(CPU *cpu) {
+    cpu->nmi_pending = false;
+    cpu->idle.armed = false;
+
     // Push PC (high byte puis low byte)
     cpu->ram[0x0100 + cpu->SP--] = (cpu->PC >> 8) & 0xFF;
     cpu->ram[0x0100 + cpu->SP--] = cpu->PC & 0xFF;
@@ -150,12 +239,91 @@ void cpu_nmi(CPU *cpu) {
     cpu->P |= 0x04;
     
     // Jump to NMI vector($FFFA-$FFFB)
-    uint16_t nmi_vector = cpu->prg_rom[0x7FFA] | (cpu->prg_rom[0x7FFB] << 8);
+    uint16_t nmi_vector = nes_read(cpu, 0xFFFA) | (nes_read(cpu, 0xFFFB) << 8);
     cpu->PC = nmi_vector;
     
     cpu->cycles += 7;
     
+#if DEBUG_CPU
     printf("NMI triggered! Jumping to $%04X\n", nmi_vector);
+#endif
+}
+
+// === Batch execution ===
+
+// PPU x3 than the CPU, for every cycle spent. An NMI raised on the way is only
+// latched: the core takes it (7 cycles) before its next instruction.
+void nes_sync_ppu(CPU *nes) {
+    while (nes->ppu_cycles < nes->cycles) {
+        uint64_t cycles = nes->cycles - nes->ppu_cycles;
+        if (cycles > 1000000) cycles = 1000000;
+        nes->ppu_cycles += cycles;
+        ppu_run(nes->ppu, (int)cycles * 3);
+    }
+}
+
+void nes_schedule_ppu(CPU *nes) {
+    if (nes->ppu) {
+        int dots = ppu_dots_until_event(nes->ppu);
+        scheduler_schedule(&nes->scheduler, SCHED_PPU, nes->ppu_cycles + (dots + 2) / 3);
+    }
+}
+
+// SCHED_PPU: run the PPU through its event, then arm the next one
+static void nes_ppu_event(CPU *nes, uint64_t time) {
+    (void)time;  // The PPU catches up on CPU::cycles
+    nes_sync_ppu(nes);
+    nes_schedule_ppu(nes);
+}
+
+static uint64_t nes_run(CPU *nes, uint64_t budget, bool until_frame) {
+    uint64_t start = nes->cycles;
+    uint64_t end = start + budget;
+
+    if (until_frame) {
+        nes->ppu->draw_flag = false;
+    }
+    nes_schedule_ppu(nes);  // The PPU may have been touched from outside
+
+    while (nes->cycles < end) {
+        // Nothing the CPU can observe changes before the next event, so it
+        // runs up to there in one call (idle loops included)
+        uint64_t next_event = scheduler_next(&nes->scheduler);
+        if (next_event > end) next_event = end;
+        cpu_execute(nes, next_event > nes->cycles ? next_event - nes->cycles : 1);
+        scheduler_run_due(&nes->scheduler, nes, nes->cycles);
+
+        if (until_frame && nes->ppu->draw_flag) {
+            break;
+        }
+    }
+    nes_sync_ppu(nes);
+    return nes->cycles - start;
+}
+
+void nes_set_tier(CPU *nes, PpuTier tier) {
+    nes->idle_skip = tier == PPU_TIER_FAST;
+    if (nes->ppu) {
+        ppu_set_tier(nes->ppu, tier);
+        nes_schedule_ppu(nes);
+    }
+}
+
+void nes_sample_input(CPU *nes) {
+    uint8_t state = 0;
+    for (int i = 0; i < 8; i++) {
+        if (nes->key[i]) state |= 1 << i;
+    }
+    nes->controller = state;
+}
+
+uint64_t nes_run_frame(CPU *nes) {
+    nes_sample_input(nes);
+    return nes_run(nes, UINT64_MAX / 2, true);
+}
+
+uint64_t nes_run_cycles(CPU *nes, uint64_t cycles) {
+    return nes_run(nes, cycles, false);
 }
 
 int load_program(CPU *nes, const char *filename) {
@@ -198,6 +366,7 @@ int load_program(CPU *nes, const char *filename) {
         return 1;
     }
     printf("✅ PRG-ROM loaded (%d KB)\n", prg_size * 16);
+    cpu_map_prg_rom(nes);
 
     // === CHR-ROM / CHR-RAM ===
     if (chr_size > 0) {
@@ -222,6 +391,7 @@ int load_program(CPU *nes, const char *filename) {
             return 1;
         }
         nes->ppu->chr_ram_enabled = false;
+        ppu_invalidate_patterns(nes->ppu, 0x0000, sizeof(nes->ppu->chr_rom));
         printf("✅ CHR-ROM loaded (8 KB)\n");
     } else {
         if (!nes->ppu) {
@@ -231,6 +401,7 @@ int load_program(CPU *nes, const char *filename) {
         }
         nes->ppu->chr_ram_enabled = true;
         memset(nes->ppu->chr_rom, 0, sizeof(nes->ppu->chr_rom));
+        ppu_invalidate_patterns(nes->ppu, 0x0000, sizeof(nes->ppu->chr_rom));
         printf("ℹ️ No CHR-ROM: using CHR-RAM (8 KB)\n");
     }
 
@@ -264,1678 +435,809 @@ int load_program(CPU *nes, const char *filename) {
     return 0;
 }
 
-// LSR – Logical Shift Right
-void cpu_lsr(CPU *nes, uint16_t addr, bool accumulator) {
-    uint8_t value;
-
-    if (accumulator) {
-        value = nes->A;
-    } else {
-        value = nes_read(nes, addr);
-    }
-
-    if (value & 0x01)
-        nes->P |= FLAG_C;
-    else
-        nes->P &= ~FLAG_C;
-
-    value >>= 1;
+// === Helpers ===
 
-    if (accumulator)
-        nes->A = value;
-    else
-        nes->ram[addr] = value;
+void update_NZ_flags(CPU *nes, uint8_t value) {
+    nes->P &= ~(FLAG_N | FLAG_Z);
+    if (value == 0) nes->P |= FLAG_Z;
+    if (value & 0x80) nes->P |= FLAG_N;
+}
 
-    if (value == 0)
-        nes->P |= FLAG_Z;
-    else
-        nes->P &= ~FLAG_Z;
+static inline void cpu_set_flag(CPU *nes, uint8_t flag, bool on) {
+    if (on) nes->P |= flag;
+    else nes->P &= ~flag;
+}
 
-    nes->P &= ~FLAG_N; // N = 0 always after LSR
+static inline void cpu_push(CPU *nes, uint8_t value) {
+    nes->ram[0x0100 + nes->SP--] = value;
 }
 
-void cpu_dcp(CPU *nes, uint16_t addr) {
-    nes->ram[addr] -= 1;
-    uint8_t value = nes->ram[addr];
+static inline uint8_t cpu_pull(CPU *nes) {
+    return nes->ram[0x0100 + ++nes->SP];
+}
 
-    // Compare with A
-    uint16_t result = nes->A - value;
+static inline uint16_t cpu_fetch16(CPU *nes) {
+    uint16_t value = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
+    nes->PC += 2;
+    return value;
+}
 
-    if (result & 0x80) nes->P |= FLAG_N; else nes->P &= ~FLAG_N;
-    if ((result & 0xFF) == 0) nes->P |= FLAG_Z; else nes->P &= ~FLAG_Z;
-    if (nes->A >= value) nes->P |= FLAG_C; else nes->P &= ~FLAG_C;
+// Pointer fetch that wraps inside the zero page
+static inline uint16_t cpu_read16_zp(CPU *nes, uint8_t zp) {
+    return nes_read(nes, zp) | (nes_read(nes, (uint8_t)(zp + 1)) << 8);
 }
 
-void update_NZ_flags(CPU *nes, uint8_t value) {
-    nes->P &= ~(FLAG_N | FLAG_Z);
-    if (value == 0) nes->P |= FLAG_Z;
-    if (value & 0x80) nes->P |= FLAG_N;
+// Branch opcodes encode their test: bits 7-6 select the flag (N, V, C, Z), bit 5 the expected value
+static inline bool cpu_branch_taken(CPU *nes, uint8_t opcode) {
+    static const uint8_t branch_flags[4] = { FLAG_N, FLAG_V, FLAG_C, FLAG_Z };
+    bool set = (nes->P & branch_flags[opcode >> 6]) != 0;
+    return set == ((opcode & 0x20) != 0);
 }
 
+// === Read-modify-write ===
+// cpu_rmw_begin returns the byte to modify in place: zero page and RAM pages hand
+// out a pointer into memory (one page lookup, no handler). Anything else is read
+// into scratch through the bus, with the 6502's dummy write of the unmodified
+// value, and cpu_rmw_end stores the result back through the bus.
 
-void nes_emulation_cycle(CPU *nes) {
-    uint8_t opcode = nes_read(nes, nes->PC++);
+static inline uint8_t *cpu_rmw_begin(CPU *nes, uint8_t mode, uint16_t addr, uint8_t *scratch) {
+    // Zero page shortcut: always internal RAM unless page 0 is watched
+    if ((mode == AM_ZP || mode == AM_ZPX) && nes->write_map[0]) {
+        return &nes->ram[addr];
+    }
 
-    switch (opcode) {
-        case 0x00: // BRK - Force Interrupt
-            printf("BRK at PC=0x%04X\n", nes->PC - 1);
-            nes->PC++;
-            break;
+    uint8_t *page = nes->write_map[addr >> CPU_PAGE_SHIFT];
+    if (page && page == nes->read_map[addr >> CPU_PAGE_SHIFT]) {
+        return &page[addr & 0xFF];
+    }
 
-        case 0x01: { // ORA (Indirect,X) - OR with memory (Indirect,X)
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t addr = nes_read(nes, (zp + nes->X) & 0xFF) |
-                        (nes_read(nes, (zp + nes->X + 1) & 0xFF) << 8);
-            uint8_t value = nes_read(nes, addr);
-            printf("ORA (Indirect,X) at PC=0x%04X, ZP=0x%02X, X=0x%02X, addr=0x%04X, value=0x%02X, A=0x%02X\n",
-                nes->PC - 1, zp, nes->X, addr, value, nes->A);
-            nes->A |= value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
+    *scratch = nes_read(nes, addr);
+    nes_write(nes, addr, *scratch);
+    return scratch;
+}
 
-        case 0x03: { // SLO (indirect,X)
-            printf("SLO (indirect,X) at PC=0x%04X\n", nes->PC - 1);
+static inline void cpu_rmw_end(CPU *nes, uint16_t addr, const uint8_t *m, const uint8_t *scratch) {
+    if (m == scratch) {
+        nes_write(nes, addr, *m);
+    }
+}
 
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint8_t ptr_low = nes->ram[(zp + nes->X) & 0xFF];
-            uint8_t ptr_high = nes->ram[(zp + nes->X + 1) & 0xFF];
-            uint16_t addr = ptr_low | (ptr_high << 8);
+// === ALU ===
 
-            uint8_t m = nes->ram[addr];
+static void cpu_adc(CPU *nes, uint8_t value) {
+    uint16_t sum = nes->A + value + (nes->P & FLAG_C);
+    cpu_set_flag(nes, FLAG_C, sum > 0xFF);
+    cpu_set_flag(nes, FLAG_V, ((nes->A ^ sum) & (value ^ sum) & 0x80) != 0);
+    nes->A = (uint8_t)sum;
+    update_NZ_flags(nes, nes->A);
+}
 
-            // --- ASL M ---
-            if (m & 0x80) nes->P |= FLAG_C;
-            else nes->P &= ~FLAG_C;
+// The NES 2A03 has no decimal mode: SBC is ADC of the complement
+static inline void cpu_sbc(CPU *nes, uint8_t value) {
+    cpu_adc(nes, ~value);
+}
 
-            m <<= 1;
-            nes->ram[addr] = m;
+static void cpu_compare(CPU *nes, uint8_t reg, uint8_t value) {
+    cpu_set_flag(nes, FLAG_C, reg >= value);
+    update_NZ_flags(nes, (uint8_t)(reg - value));
+}
 
-            // --- ORA M ---
-            nes->A |= m;
+static uint8_t cpu_asl(CPU *nes, uint8_t value) {
+    cpu_set_flag(nes, FLAG_C, value & 0x80);
+    value <<= 1;
+    update_NZ_flags(nes, value);
+    return value;
+}
 
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
+static uint8_t cpu_lsr(CPU *nes, uint8_t value) {
+    cpu_set_flag(nes, FLAG_C, value & 0x01);
+    value >>= 1;
+    update_NZ_flags(nes, value);
+    return value;
+}
 
-            break;
-        }
+static uint8_t cpu_rol(CPU *nes, uint8_t value) {
+    uint8_t carry = nes->P & FLAG_C;
+    cpu_set_flag(nes, FLAG_C, value & 0x80);
+    value = (value << 1) | carry;
+    update_NZ_flags(nes, value);
+    return value;
+}
 
-        case 0x04: { // NOP zeropage
-            printf("NOP zeropage at PC=0x%04X\n", nes->PC - 1);
-            nes->PC++;
-            break;
-        }
+static uint8_t cpu_ror(CPU *nes, uint8_t value) {
+    uint8_t carry = (nes->P & FLAG_C) ? 0x80 : 0x00;
+    cpu_set_flag(nes, FLAG_C, value & 0x01);
+    value = (value >> 1) | carry;
+    update_NZ_flags(nes, value);
+    return value;
+}
 
+// === Trace ===
 
-        case 0x06: { // ASL zeropage
-            printf("ASL zeropage at PC=0x%04X\n", nes->PC - 1);
+#ifdef CPU_TRACE
+// Operand bytes without I/O side effects
+static uint8_t cpu_peek(CPU *nes, uint16_t addr) {
+    if (addr >= 0x2000 && addr < 0x4020) return 0;
+    return nes_read(nes, addr);
+}
 
-            uint8_t addr = nes_read(nes, nes->PC++);
+static void cpu_trace(CPU *nes, uint16_t pc, uint8_t opcode) {
+    uint8_t size = addr_mode_size[opcode_table[opcode].mode];
+    TraceRecord record = {
+        .cycle = nes->cycles,
+        .pc = pc,
+        .opcode = opcode,
+        .operand = { size > 0 ? cpu_peek(nes, pc + 1) : 0, size > 1 ? cpu_peek(nes, pc + 2) : 0 },
+        .a = nes->A, .x = nes->X, .y = nes->Y, .p = nes->P, .sp = nes->SP
+    };
+    trace_push(nes->trace, &record);
+}
 
-            uint8_t val = nes->ram[addr];
+#define CPU_TRACE_INSTRUCTION(nes, pc, opcode) \
+    do { if ((nes)->trace) cpu_trace((nes), (pc), (opcode)); } while (0)
+#else
+#define CPU_TRACE_INSTRUCTION(nes, pc, opcode) ((void)0)
+#endif
 
-            
-            if (val & 0x80) nes->P |= FLAG_C; 
-            else nes->P &= ~FLAG_C;
+// === Execution ===
 
-            // bitshift on the left
-            val <<= 1;
-            nes->ram[addr] = val;
+// Run an instruction whose effective address is already resolved.
+// Shared by the reference core and the block cache, returns the cycles spent.
+static int cpu_operate(CPU *nes, uint8_t opcode, uint16_t addr, bool page_crossed) {
+    const Opcode *op = &opcode_table[opcode];
+    int cycles = op->cycles;
 
-            update_NZ_flags(nes, val);
+    if (page_crossed && op->page_penalty) {
+        cycles++;
+    }
 
+    // === Operation ===
+    switch (op->op) {
+        // --- Load / Store ---
+        case OP_LDA: nes->A = nes_read(nes, addr); update_NZ_flags(nes, nes->A); break;
+        case OP_LDX: nes->X = nes_read(nes, addr); update_NZ_flags(nes, nes->X); break;
+        case OP_LDY: nes->Y = nes_read(nes, addr); update_NZ_flags(nes, nes->Y); break;
+        case OP_STA: nes_write(nes, addr, nes->A); break;
+        case OP_STX: nes_write(nes, addr, nes->X); break;
+        case OP_STY: nes_write(nes, addr, nes->Y); break;
+
+        // --- Transfers ---
+        case OP_TAX: nes->X = nes->A; update_NZ_flags(nes, nes->X); break;
+        case OP_TAY: nes->Y = nes->A; update_NZ_flags(nes, nes->Y); break;
+        case OP_TXA: nes->A = nes->X; update_NZ_flags(nes, nes->A); break;
+        case OP_TYA: nes->A = nes->Y; update_NZ_flags(nes, nes->A); break;
+        case OP_TSX: nes->X = nes->SP; update_NZ_flags(nes, nes->X); break;
+        case OP_TXS: nes->SP = nes->X; break;
+
+        // --- Stack ---
+        case OP_PHA: cpu_push(nes, nes->A); break;
+        case OP_PHP: cpu_push(nes, nes->P | FLAG_B | FLAG_U); break;
+        case OP_PLA: nes->A = cpu_pull(nes); update_NZ_flags(nes, nes->A); break;
+        case OP_PLP: nes->P = (cpu_pull(nes) & ~FLAG_B) | FLAG_U; break;
+
+        // --- Logic / Arithmetic ---
+        case OP_AND: nes->A &= nes_read(nes, addr); update_NZ_flags(nes, nes->A); break;
+        case OP_ORA: nes->A |= nes_read(nes, addr); update_NZ_flags(nes, nes->A); break;
+        case OP_EOR: nes->A ^= nes_read(nes, addr); update_NZ_flags(nes, nes->A); break;
+        case OP_ADC: cpu_adc(nes, nes_read(nes, addr)); break;
+        case OP_SBC: cpu_sbc(nes, nes_read(nes, addr)); break;
+        case OP_CMP: cpu_compare(nes, nes->A, nes_read(nes, addr)); break;
+        case OP_CPX: cpu_compare(nes, nes->X, nes_read(nes, addr)); break;
+        case OP_CPY: cpu_compare(nes, nes->Y, nes_read(nes, addr)); break;
+
+        case OP_BIT: {
+            uint8_t value = nes_read(nes, addr);
+            cpu_set_flag(nes, FLAG_Z, (nes->A & value) == 0);
+            cpu_set_flag(nes, FLAG_V, value & 0x40);
+            cpu_set_flag(nes, FLAG_N, value & 0x80);
             break;
         }
 
-        case 0x07: { // SLO (zeropage)
-            printf("SLO at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            uint8_t value = nes->ram[addr];
-
-            if (value & 0x80) nes->P |= FLAG_C; else nes->P &= ~FLAG_C;
-            value <<= 1;
-            nes->ram[addr] = value;
-
-            nes->A |= value;
+        // --- Increments / Decrements ---
+        case OP_INX: nes->X++; update_NZ_flags(nes, nes->X); break;
+        case OP_INY: nes->Y++; update_NZ_flags(nes, nes->Y); break;
+        case OP_DEX: nes->X--; update_NZ_flags(nes, nes->X); break;
+        case OP_DEY: nes->Y--; update_NZ_flags(nes, nes->Y); break;
 
-            update_NZ_flags(nes, nes->A);
+        case OP_INC: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            update_NZ_flags(nes, ++*m);
+            cpu_rmw_end(nes, addr, m, &scratch);
             break;
         }
 
-        case 0x08: { // PHP (Push Processor Status)
-            printf("PHP at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t status = nes->P | 0x30;
-
-            nes->ram[0x0100 + nes->SP] = status;
-            nes->SP--;
-
+        case OP_DEC: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            update_NZ_flags(nes, --*m);
+            cpu_rmw_end(nes, addr, m, &scratch);
             break;
         }
 
+        // --- Shifts ---
+        case OP_ASL:
+            if (op->mode == AM_ACC) {
+                nes->A = cpu_asl(nes, nes->A);
+            } else {
+                uint8_t scratch;
+                uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+                *m = cpu_asl(nes, *m);
+                cpu_rmw_end(nes, addr, m, &scratch);
+            }
+            break;
 
-        case 0x0A: { // ASL accumulator
-            printf("ASL A at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t old = nes->A;
+        case OP_LSR:
+            if (op->mode == AM_ACC) {
+                nes->A = cpu_lsr(nes, nes->A);
+            } else {
+                uint8_t scratch;
+                uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+                *m = cpu_lsr(nes, *m);
+                cpu_rmw_end(nes, addr, m, &scratch);
+            }
+            break;
 
-            if (old & 0x80) 
-                nes->P |= FLAG_C;
-            else 
-                nes->P &= ~FLAG_C;
+        case OP_ROL:
+            if (op->mode == AM_ACC) {
+                nes->A = cpu_rol(nes, nes->A);
+            } else {
+                uint8_t scratch;
+                uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+                *m = cpu_rol(nes, *m);
+                cpu_rmw_end(nes, addr, m, &scratch);
+            }
+            break;
 
-            nes->A <<= 1;
+        case OP_ROR:
+            if (op->mode == AM_ACC) {
+                nes->A = cpu_ror(nes, nes->A);
+            } else {
+                uint8_t scratch;
+                uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+                *m = cpu_ror(nes, *m);
+                cpu_rmw_end(nes, addr, m, &scratch);
+            }
+            break;
 
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
+        // --- Jumps / Calls ---
+        case OP_JMP: nes->PC = addr; break;
 
-            nes->PC++;
+        case OP_JSR: {
+            uint16_t return_addr = nes->PC - 1;
+            cpu_push(nes, (return_addr >> 8) & 0xFF);
+            cpu_push(nes, return_addr & 0xFF);
+            nes->PC = addr;
             break;
         }
 
-
-        case 0x0C:  // NOP (immediate / absolute)
-            printf("NOP at PC=0x%04X\n", nes->PC - 1);
-            nes->PC += 2;
+        case OP_RTS: {
+            uint8_t pcl = cpu_pull(nes);
+            uint8_t pch = cpu_pull(nes);
+            nes->PC = (((uint16_t)pch << 8) | pcl) + 1;
             break;
-        
-        case 0x0D: { // ORA absolute
-            printf("ORA absolute at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint8_t value = nes_read(nes, addr);
-
-            nes->A |= value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
+        }
 
+        case OP_RTI: {
+            nes->P = (cpu_pull(nes) & ~FLAG_B) | FLAG_U;
+            uint8_t pcl = cpu_pull(nes);
+            uint8_t pch = cpu_pull(nes);
+            nes->PC = ((uint16_t)pch << 8) | pcl;
             break;
         }
 
-        case 0x0F: {  // SLO / ASO zeropage,X
-            printf("SLO (zeropage,X) at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
-
-            // ASL M
-            uint8_t m = nes->ram[addr];
-            if (m & 0x80) nes->P |= FLAG_C;
-            else nes->P &= ~FLAG_C;
-
-            m <<= 1;
-            nes->ram[addr] = m;
-
-            // ORA M -> A
-            nes->A |= m;
-
-            // Flags N et Z
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->A & 0x80) nes->P |= FLAG_N;
-            if (nes->A == 0) nes->P |= FLAG_Z;
-
+        case OP_BRK: {
+            // BRK skips a padding byte
+            uint16_t return_addr = nes->PC + 1;
+            cpu_push(nes, (return_addr >> 8) & 0xFF);
+            cpu_push(nes, return_addr & 0xFF);
+            cpu_push(nes, nes->P | FLAG_B | FLAG_U);
+            nes->P |= FLAG_I;
+            nes->PC = nes_read(nes, 0xFFFE) | (nes_read(nes, 0xFFFF) << 8);
             break;
         }
 
-
-        
-        case 0x10:
-            printf("BPL at PC=0x%04X\n", nes->PC - 1);
-            if ((nes->P & FLAG_N) == 0) {
-                int8_t offset = nes_read(nes, nes->PC);
-                nes->PC += 1 + offset;
-            } else {
-                nes->PC += 1;
+        // --- Branches: +1 cycle if taken, +1 more if the target is on another page ---
+        case OP_BPL: case OP_BMI: case OP_BVC: case OP_BVS:
+        case OP_BCC: case OP_BCS: case OP_BNE: case OP_BEQ:
+            if (cpu_branch_taken(nes, opcode)) {
+                nes->PC = addr;
+                cycles += page_crossed ? 2 : 1;
             }
             break;
 
-        case 0x13: { // SLO (Indirect),Y
-            printf("SLO (Indirect),Y at PC=0x%04X\n", nes->PC - 1);
+        // --- Flags ---
+        case OP_CLC: nes->P &= ~FLAG_C; break;
+        case OP_CLD: nes->P &= ~FLAG_D; break;
+        case OP_CLI: nes->P &= ~FLAG_I; break;
+        case OP_CLV: nes->P &= ~FLAG_V; break;
+        case OP_SEC: nes->P |= FLAG_C; break;
+        case OP_SED: nes->P |= FLAG_D; break;
+        case OP_SEI: nes->P |= FLAG_I; break;
 
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t base = nes->ram[zp] | (nes->ram[(zp + 1) & 0xFF] << 8);
-            uint16_t addr = base + nes->Y;
-
-            uint8_t val = nes_read(nes, addr);
-
-            if (val & 0x80) nes->P |= FLAG_C; else nes->P &= ~FLAG_C;
-            val <<= 1;
-
-            nes->ram[addr] = val;
+        case OP_NOP:
+            break;
 
-            // ORA : A = A | M
-            nes->A |= val;
+        // --- Illegal opcodes ---
+        case OP_SLO: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            *m = cpu_asl(nes, *m);
+            nes->A |= *m;
+            update_NZ_flags(nes, nes->A);
+            cpu_rmw_end(nes, addr, m, &scratch);
+            break;
+        }
 
+        case OP_RLA: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            *m = cpu_rol(nes, *m);
+            nes->A &= *m;
             update_NZ_flags(nes, nes->A);
+            cpu_rmw_end(nes, addr, m, &scratch);
+            break;
+        }
 
+        case OP_SRE: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            *m = cpu_lsr(nes, *m);
+            nes->A ^= *m;
+            update_NZ_flags(nes, nes->A);
+            cpu_rmw_end(nes, addr, m, &scratch);
             break;
         }
 
-        case 0x16: { // ASL zeropage,X
-            printf("ASL zeropage,X at PC=0x%04X\n", nes->PC - 1);
+        case OP_RRA: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            *m = cpu_ror(nes, *m);
+            cpu_adc(nes, *m);
+            cpu_rmw_end(nes, addr, m, &scratch);
+            break;
+        }
 
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
+        case OP_DCP: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            --*m;
+            cpu_compare(nes, nes->A, *m);
+            cpu_rmw_end(nes, addr, m, &scratch);
+            break;
+        }
 
-            uint8_t val = nes->ram[addr];
+        case OP_ISC: {
+            uint8_t scratch;
+            uint8_t *m = cpu_rmw_begin(nes, op->mode, addr, &scratch);
+            ++*m;
+            cpu_sbc(nes, *m);
+            cpu_rmw_end(nes, addr, m, &scratch);
+            break;
+        }
 
-            if (val & 0x80) nes->P |= FLAG_C; 
-            else nes->P &= ~FLAG_C;
+        case OP_SAX: nes_write(nes, addr, nes->A & nes->X); break;
 
-            val <<= 1;
-            nes->ram[addr] = val;
+        case OP_LAX:
+            nes->A = nes->X = nes_read(nes, addr);
+            update_NZ_flags(nes, nes->A);
+            break;
 
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (val == 0) nes->P |= FLAG_Z;
-            if (val & 0x80) nes->P |= FLAG_N;
+        case OP_LAS:
+            nes->A = nes->X = nes->SP = nes_read(nes, addr) & nes->SP;
+            update_NZ_flags(nes, nes->A);
+            break;
 
+        case OP_ANC:
+            nes->A &= nes_read(nes, addr);
+            update_NZ_flags(nes, nes->A);
+            cpu_set_flag(nes, FLAG_C, nes->A & 0x80);
             break;
-        }
 
-        case 0x17: { // ORA (Indirect),Y
-            printf("ORA (Indirect),Y at PC=0x%04X\n", nes->PC - 1);
-            uint8_t zp = nes_read(nes, nes->PC);
-            nes->PC += 1;
+        case OP_ALR:
+            nes->A = cpu_lsr(nes, nes->A & nes_read(nes, addr));
+            break;
 
-            uint16_t base = nes_read(nes, zp) | (nes_read(nes, (uint8_t)(zp + 1)) << 8);
-            uint16_t addr = base + nes->Y;
+        case OP_ARR: {
+            uint8_t carry = (nes->P & FLAG_C) ? 0x80 : 0x00;
+            nes->A = ((nes->A & nes_read(nes, addr)) >> 1) | carry;
+            update_NZ_flags(nes, nes->A);
+            cpu_set_flag(nes, FLAG_C, nes->A & 0x40);
+            cpu_set_flag(nes, FLAG_V, ((nes->A >> 6) ^ (nes->A >> 5)) & 0x01);
+            break;
+        }
 
+        case OP_SBX: {
             uint8_t value = nes_read(nes, addr);
-            nes->A |= value;
-
-            update_NZ_flags(nes, nes->A);
+            uint8_t ax = nes->A & nes->X;
+            cpu_set_flag(nes, FLAG_C, ax >= value);
+            nes->X = ax - value;
+            update_NZ_flags(nes, nes->X);
             break;
         }
 
-        
-        case 0x18:
-            printf("CLC at PC=0x%04X\n", nes->PC - 1);
-            nes->P &= ~FLAG_C;
-            nes->PC++;
+        case OP_XAA:
+            // Unstable on hardware, $EE is the commonly observed magic constant
+            nes->A = (nes->A | 0xEE) & nes->X & nes_read(nes, addr);
+            update_NZ_flags(nes, nes->A);
             break;
 
-        case 0x19: { // ORA absolute,Y
-            printf("ORA absolute,Y at PC=0x%04X\n", nes->PC - 1);
+        // Unstable stores: value is ANDed with the high byte of the address + 1
+        case OP_SHA: nes_write(nes, addr, nes->A & nes->X & ((addr >> 8) + 1)); break;
+        case OP_SHX: nes_write(nes, addr, nes->X & ((addr >> 8) + 1)); break;
+        case OP_SHY: nes_write(nes, addr, nes->Y & ((addr >> 8) + 1)); break;
+
+        case OP_TAS:
+            nes->SP = nes->A & nes->X;
+            nes_write(nes, addr, nes->SP & ((addr >> 8) + 1));
+            break;
 
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
+        case OP_JAM:
+            printf("⚠️ JAM opcode 0x%02X at PC=0x%04X, skipping\n", opcode, nes->PC - 1);
+            nes->PC++; // jmp instruc so as not to block
+            break;
+    }
 
-            uint16_t effective_addr = addr + nes->Y;
+    return cycles;
+}
 
-            uint8_t value = nes_read(nes, effective_addr);
+// Execute one instruction and return the number of CPU cycles it took
+int nes_emulation_cycle(CPU *nes) {
+    uint8_t opcode = nes_read(nes, nes->PC++);
+    const Opcode *op = &opcode_table[opcode];
 
-            nes->A |= value;
+    uint16_t addr = 0;
+    bool page_crossed = false;
 
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
+    CPU_TRACE_INSTRUCTION(nes, nes->PC - 1, opcode);
 
+    // === Effective address ===
+    switch (op->mode) {
+        case AM_IMP:
+        case AM_ACC:
             break;
-        }
-
-        case 0x1D: { // ORA absolute,X
-            printf("ORA absolute,X at PC=0x%04X\n", nes->PC - 1);
 
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
+        case AM_IMM:
+            addr = nes->PC++;
+            break;
 
-            uint16_t effective_addr = addr + nes->X;
+        case AM_ZP:
+            addr = nes_read(nes, nes->PC++);
+            break;
 
-            uint8_t value = nes_read(nes, effective_addr);
+        case AM_ZPX:
+            addr = (uint8_t)(nes_read(nes, nes->PC++) + nes->X);
+            break;
 
-            nes->A |= value;
+        case AM_ZPY:
+            addr = (uint8_t)(nes_read(nes, nes->PC++) + nes->Y);
+            break;
 
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
+        case AM_ABS:
+            addr = cpu_fetch16(nes);
+            break;
 
+        case AM_ABX: {
+            uint16_t base = cpu_fetch16(nes);
+            addr = base + nes->X;
+            page_crossed = (base ^ addr) & 0xFF00;
             break;
         }
 
-        
-        case 0x20: { // JSR absolute
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            uint16_t return_addr = nes->PC + 1;
-            nes->ram[0x0100 + nes->SP--] = (return_addr >> 8) & 0xFF;
-            nes->ram[0x0100 + nes->SP--] = return_addr & 0xFF;
-            nes->PC = addr;
+        case AM_ABY: {
+            uint16_t base = cpu_fetch16(nes);
+            addr = base + nes->Y;
+            page_crossed = (base ^ addr) & 0xFF00;
             break;
         }
 
-        case 0x21: { // AND (Indirect,X)
-            printf("AND (Indirect,X) at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t oper = nes_read(nes, nes->PC++);
-            uint8_t zp_addr = (oper + nes->X) & 0xFF;
-
-            uint16_t addr = nes->ram[zp_addr] | (nes->ram[(zp_addr + 1) & 0xFF] << 8);
-
-            uint8_t value = nes_read(nes, addr);
-            nes->A &= value;
+        case AM_IND: {
+            // 6502 bug: the high byte is read without carrying into the next page
+            uint16_t ptr = cpu_fetch16(nes);
+            addr = nes_read(nes, ptr) |
+                   (nes_read(nes, (ptr & 0xFF00) | ((ptr + 1) & 0x00FF)) << 8);
+            break;
+        }
 
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if(nes->A == 0) nes->P |= FLAG_Z;
-            if(nes->A & 0x80) nes->P |= FLAG_N;
+        case AM_IZX:
+            addr = cpu_read16_zp(nes, nes_read(nes, nes->PC++) + nes->X);
+            break;
 
+        case AM_IZY: {
+            uint16_t base = cpu_read16_zp(nes, nes_read(nes, nes->PC++));
+            addr = base + nes->Y;
+            page_crossed = (base ^ addr) & 0xFF00;
             break;
         }
 
+        case AM_REL: {
+            int8_t offset = nes_read(nes, nes->PC++);
+            addr = nes->PC + offset;
+            page_crossed = (nes->PC ^ addr) & 0xFF00;
+            break;
+        }
+    }
 
-        case 0x23: { // RLA (indirect,X)
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t ptr = (uint8_t)(zp + nes->X); // stay on 0x00-0xFF
-            uint16_t addr = nes->ram[ptr] | (nes->ram[(ptr+1)&0xFF] << 8);
-            if (addr == 0x0000) {
-                printf("⚠️ RLA pointer invalid, skipping\n");
-                break;
-            }
+    int cycles = cpu_operate(nes, opcode, addr, page_crossed);
+    nes->cycles += cycles;
+    return cycles;
+}
 
+// === Idle loops ===
+// Games wait for vblank in loops like `LDA $2002 / BPL` or `LDA flag / BEQ`.
+// A loop qualifies when its body only reads memory without side effects (RAM,
+// PRG, PPUSTATUS, whose read is idempotent after the first iteration) and its
+// only way back to the head is the closing branch/JMP. Nothing outside the CPU
+// runs inside a cpu_execute call, so once an iteration ends in the state it
+// started in, all the following ones until the budget runs out are identical.
+
+// Reads the loop may repeat without changing anything
+static bool cpu_idle_read_is_pure(CPU *nes, uint16_t addr) {
+    uint8_t page = addr >> CPU_PAGE_SHIFT;
+
+    if (nes->page_watched[page]) return false;
+    if (nes->read_map[page]) return true;
+    return (addr & 0xE007) == PPUSTATUS && nes->io_read[page] == cpu_ppu_read;
+}
 
-            uint8_t value = nes_read(nes, addr);
+static bool cpu_idle_code_byte(CPU *nes, uint16_t addr, uint8_t *value) {
+    const uint8_t *page = nes->read_map[addr >> CPU_PAGE_SHIFT];
+    if (!page) return false;
+    *value = page[addr & 0xFF];
+    return true;
+}
 
-            bool old_c = nes->P & FLAG_C;
-            nes->P &= ~FLAG_C;
-            if (value & 0x80) nes->P |= FLAG_C;
-
-            value = (value << 1) | (old_c ? 1 : 0);
-            nes->ram[addr] = value;
-
-            nes->A &= value;
-            update_NZ_flags(nes, nes->A);
-
-            printf("RLA: ZP=0x%02X, addr=0x%04X, val=0x%02X, A=0x%02X\n", zp, addr, value, nes->A);
-            break;
-        }
-
-        case 0x24: { // BIT zeropage
-            printf("BIT zeropage at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t addr = nes_read(nes, nes->PC++);
-            uint8_t operand = nes_read(nes, addr);
-
-            nes->P &= ~FLAG_Z;
-            if ((nes->A & operand) == 0)
-                nes->P |= FLAG_Z;
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-        case 0x25: { // AND Zeropage
-            printf("AND zeropage at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            uint8_t value = nes_read(nes, addr);
-            nes->A &= value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-
-        case 0x26: { // ROL zeropage
-            printf("ROL zeropage at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t addr = nes->ram[nes->PC++];
-            
-            uint8_t val = nes->ram[addr];
-
-            uint8_t old_carry = (nes->P & FLAG_C) ? 1 : 0;
-
-            if (val & 0x80) nes->P |= FLAG_C;
-            else nes->P &= ~FLAG_C;
-
-            val = (val << 1) | old_carry;
-
-            nes->ram[addr] = val;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (val == 0) nes->P |= FLAG_Z;
-            if (val & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0x29: { // AND immediate
-            printf("AND immediate at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t value = nes_read(nes, nes->PC++);
-            nes->A &= value;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-
-        case 0x2C: { // BIT absolute
-            printf("BIT at PC=0x%04X\n", nes->PC - 1);
-            
-            
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint8_t operand = nes_read(nes, addr);
-
-            if ((nes->A & operand) == 0)
-                nes->P |= FLAG_Z;
-            else
-                nes->P &= ~FLAG_Z;
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-        case 0x2D: { // AND absolute
-            printf("AND absolute at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint8_t value = nes_read(nes, addr);
-
-            nes->A &= value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->A == 0) nes->P |= FLAG_Z;
-            if (nes->A & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-
-        case 0x30: { // BMI relative
-            printf("BMI at PC=0x%04X\n", nes->PC - 1);
-
-            int8_t offset = nes_read(nes, nes->PC++);
-
-            if (nes->P & FLAG_N) {
-                nes->PC += offset;
-            }
-
-            break;
-        }
-
-        case 0x34: { // NOP zeropage,X
-            printf("NOP zeropage,X at PC=0x%04X\n", nes->PC - 1);
-            nes->PC++;
-            break;
-        }
-
-        case 0x35: { // AND Zeropage,X
-            printf("AND zeropage,X at PC=0x%04X\n", nes->PC - 1);
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
-            uint8_t value = nes_read(nes, addr);
-            nes->A &= value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0x38: { // SED — Set Decimal Flag
-            printf("SEC at PC=0x%04X\n", nes->PC - 1);
-
-            nes->P |= FLAG_C;
-            break;
-        }
-
-        case 0x3E: { // ROL absolute,X
-            printf("ROL absolute,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t base = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint16_t addr = base + nes->X;
-
-            uint8_t val = nes->ram[addr];
-
-            uint8_t old_carry = (nes->P & FLAG_C) ? 1 : 0;
-
-            if (val & 0x80) nes->P |= FLAG_C;
-            else nes->P &= ~FLAG_C;
-
-            val = (val << 1) | old_carry;
-
-            nes->ram[addr] = val;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (val == 0) nes->P |= FLAG_Z;
-            if (val & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0x40: { // RTI - Return from Interrupt
-            printf("RTI at PC=0x%04X\n", nes->PC - 1);
-
-            // pull Status Register from stack
-            nes->P = nes->stack[++nes->SP];
-
-            // bit 5 is ignored (always set)
-            nes->P |= FLAG_U;
-
-            // pull Program Counter from stack (low byte first)
-            uint8_t pcl = nes->stack[++nes->SP];
-            uint8_t pch = nes->stack[++nes->SP];
-            nes->PC = ((uint16_t)pch << 8) | pcl;
-
-            break;
-        }
-
-        case 0x45: { // EOR Zeropage - Exclusive OR with Zeropage
-            uint8_t addr = nes_read(nes, nes->PC++);
-            uint8_t value = nes_read(nes, addr);
-            printf("EOR zeropage at PC=0x%04X, addr=0x%02X, value=0x%02X, A=0x%02X\n",
-                nes->PC - 1, addr, value, nes->A);
-            nes->A ^= value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0x46: { // LSR $nn
-            printf("LSR at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            cpu_lsr(nes, addr, false);
-            break;
-        }
-
-        case 0x48: { // PHA - Push Accumulator
-            printf("PHA at PC=0x%04X\n", nes->PC - 1);
-
-            nes->ram[0x0100 + nes->SP] = nes->A;
-            nes->SP--;
-
-            break;
-        }
-
-
-        case 0x49: {
-            printf("EOR at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->A = nes->A ^ nes->ram[addr];
-            update_NZ_flags(nes, nes->A);
-            nes->PC += 2;
-            break;
-        }
-
-        case 0x4A: { // LSR A
-            printf("LSR A at PC=0x%04X\n", nes->PC - 1);
-
-            if (nes->A & 0x01) nes->P |= FLAG_C;
-            else nes->P &= ~FLAG_C;
-
-            nes->A >>= 1;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->A == 0) nes->P |= FLAG_Z;
- 
-            break;
-        }
-
-
-        case 0x4C: { // JMP absolute
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            printf("JMP to 0x%04X at PC=0x%04X\n", addr, nes->PC);
-            nes->PC = addr;
-            break;
-        }
-
-
-        case 0x60: {
-            printf("RTS at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t pcl = nes->ram[0x0100 + ++nes->SP];  // pop low byte
-            uint8_t pch = nes->ram[0x0100 + ++nes->SP];  // pop high byte
-
-            nes->PC = ((uint16_t)pch << 8) | pcl;
-            nes->PC++;
-
-            break;
-        }
-
-        case 0x63: { // RRA (indirect,X)
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t addr = nes->ram[(zp + nes->X) & 0xFF] | (nes->ram[(zp + nes->X + 1) & 0xFF] << 8);
-            uint8_t value = nes_read(nes, addr);
-
-            bool old_c = nes->P & FLAG_C;
-            nes->P &= ~FLAG_C;
-            if (value & 0x01) nes->P |= FLAG_C;
-
-            value = (value >> 1) | (old_c ? 0x80 : 0x00);
-            nes->ram[addr] = value;
-
-            uint16_t sum = nes->A + value + (nes->P & FLAG_C);
-            nes->A = sum & 0xFF;
-
-            update_NZ_flags(nes, nes->A);
-            if (sum > 0xFF) nes->P |= FLAG_C; else nes->P &= ~FLAG_C;
-            break;
-        }
-
-        case 0x64:
-            printf("NOP at PC=0x%04X\n", nes->PC - 1);
-            break;
-
-        case 0x66: { // ROR Zeropage - Rotate Right (with carry)
-            uint8_t addr = nes_read(nes, nes->PC++);
-            uint8_t value = nes_read(nes, addr);
-            printf("ROR zeropage at PC=0x%04X, addr=0x%02X, value=0x%02X, carry=%d\n",
-                nes->PC - 1, addr, value, (nes->P & FLAG_C) ? 1 : 0);
-
-            uint8_t old_carry = (nes->P & FLAG_C) ? 0x80 : 0x00;
-            if (value & 0x01) {
-                nes->P |= FLAG_C;
-            } else {
-                nes->P &= ~FLAG_C;
-            }
-
-            value = (value >> 1) | old_carry;
-            nes_write(nes, addr, value);
-
-            update_NZ_flags(nes, value);
-            break;
-        }
-
-        case 0x68: { // PLA - Pull Accumulator from stack
-            printf("PLA at PC=0x%04X, SP=0x%02X\n", nes->PC - 1, nes->SP);
-            nes->A = nes->ram[0x0100 + ++nes->SP];
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0x69: { // ADC immediate
-            printf("ADC at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t value = nes_read(nes, nes->PC); 
-            uint16_t sum = nes->A + value + (nes->P & FLAG_C);
-
-            nes->P &= ~(FLAG_C | FLAG_Z | FLAG_V | FLAG_N); // Clear C, Z, V, N
-            if (sum > 0xFF) nes->P |= FLAG_C; // Carry
-            if ((uint8_t)sum == 0) nes->P |= FLAG_Z; // Zero
-            if (((nes->A ^ sum) & (value ^ sum) & FLAG_N) != 0) nes->P |= FLAG_V; // Overflow
-            if (sum & FLAG_N) nes->P |= FLAG_N; // Negative
-
-            nes->A = (uint8_t)sum;
-            nes->PC += 1;
-            break;
-        }
-
-        case 0x6B: { // ARR immediate
-            printf("ARR #oper at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t operand = nes_read(nes, nes->PC++);
-            nes->A &= operand;
-
-            bool old_c = nes->P & FLAG_C;
-            nes->P &= ~(FLAG_C | FLAG_V | FLAG_Z | FLAG_N); // clear flags
-            nes->A = (nes->A >> 1) | (old_c ? 0x80 : 0x00);
-
-            // Flag Update
-            if (nes->A == 0) nes->P |= FLAG_Z;          // Z
-            if (nes->A & 0x80) nes->P |= FLAG_N;        // N
-            if (nes->A & 0x40) nes->P |= FLAG_V;        // V = bit 6 après rotation
-            if (nes->A & 0x01) nes->P |= FLAG_C;        // C = bit 0 après rotation
-
-            break;
-        }
-
-        case 0x70: { // BVS relative
-            int8_t offset = nes_read(nes, nes->PC++);
-            if (nes->P & FLAG_V) { // flag V = 1 ?
-                nes->PC += offset; // do the jump
-            }
-            break;
-        }
-
-        case 0x7E: { // ROR absolute,X
-            printf("ROR absolute,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t base = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint16_t addr = base + nes->X;
-
-            uint8_t val = nes->ram[addr];
-
-            uint8_t old_carry = (nes->P & FLAG_C) ? 0x80 : 0;
-
-            if (val & 0x01) nes->P |= FLAG_C;
-            else nes->P &= ~FLAG_C;
-
-            val = (val >> 1) | old_carry;
-
-            nes->ram[addr] = val;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (val == 0) nes->P |= FLAG_Z;
-            if (val & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0x78:
-            printf("SEI at PC=0x%04X\n", nes->PC - 1);
-            nes->P |= FLAG_I;
-            break;
-
-        case 0x80: { // NOP immediate
-            uint8_t operand = nes->prg_rom[nes->PC];
-            nes->PC += 1;
-            printf("NOP #$%02X at PC=0x%04X\n", operand, nes->PC - 2);
-            break;
-        }
-
-
-        case 0x84: { // STY zeropage
-            printf("STY zeropage at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            nes_write(nes, addr, nes->Y);
-            break;
-        }
-
-        case 0x85: { // STA zeropage
-            printf("STA zeropage at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            nes_write(nes, addr, nes->A);
-            break;
-        }
-
-        case 0x86: { // STX Zeropage - Store X register in memory (Zeropage)
-            uint8_t addr = nes_read(nes, nes->PC++);
-            printf("STX zeropage at PC=0x%04X, addr=0x%02X, X=0x%02X\n",
-                nes->PC - 1, addr, nes->X);
-            nes_write(nes, addr, nes->X);
-            break;
-        }
-
-        case 0x88: { // DEY
-            printf("DEY at PC=0x%04X\n", nes->PC - 1);
-            nes->Y -= 1;
-            
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->Y == 0) nes->P |= FLAG_Z;
-            if (nes->Y & 0x80) nes->P |= FLAG_N;
-            break;
-        }
-
-        case 0x8A: { // TXA - Transfer X to Accumulator
-            printf("TXA at PC=0x%04X\n", nes->PC - 1);
-            nes->A = nes->X;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-
-        case 0x8C: { // STY absolute
-            printf("STY absolute at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-            nes_write(nes, addr, nes->Y);
-            break;
-        }
-
-        case 0x8D: {  // STA absolute
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            printf("STA: Writing A=0x%02X to addr=0x%04X\n", nes->A, addr);
-            nes_write(nes, addr, nes->A);
-            nes->PC += 2;
-            break;
-        }
-
-        case 0x8E: {
-            printf("STX at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes_write(nes, addr, nes->X);
-            nes->PC += 2;
-            break;
-        }
-
-        case 0x90: {
-            printf("BCC at PC=0x%04X\n", nes->PC - 1);
-            if ((nes->P & FLAG_C) == 0) { // if C = 0
-                int8_t offset = nes_read(nes, nes->PC);
-                nes->PC += 1 + offset;
-            } else {
-                nes->PC++;
-            }
-            break;
-        }
-
-        case 0x91: { // STA (Indirect),Y
-            printf("STA (Indirect),Y at PC=0x%04X\n", nes->PC - 1);
-            
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t base = nes_read(nes, zp) | (nes_read(nes, (uint8_t)(zp + 1)) << 8);
-            uint16_t addr = base + nes->Y;
-            
-            nes_write(nes, addr, nes->A);
-            break;
-        }
-
-        case 0x94: { // STY zeropage,X 
-            printf("STY zeropage,X at PC=0x%04X\n", nes->PC - 1);
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
-            nes_write(nes, addr, nes->Y);
-            break;
-        }
-
-        case 0x95: { // STA zeropage,X
-            printf("STA zeropage,X at PC=0x%04X\n", nes->PC - 1);
-            uint8_t zp_addr = nes_read(nes, nes->PC++);
-            uint8_t addr = (zp_addr + nes->X) & 0xFF;
-            nes_write(nes, addr, nes->A);
-            break;
-        }
-
-        case 0x98: { // TYA - Transfer Y to Accumulator
-            printf("TYA at PC=0x%04X\n", nes->PC - 1);
-            nes->A = nes->Y;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-
-        case 0x9A: { // TSX
-            printf("TSX at PC=0x%04X\n", nes->PC - 1);
-            nes->X = nes->SP; // SP -> X
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->X == 0) nes->P |= FLAG_Z;
-            if (nes->X & FLAG_N) nes->P |= FLAG_N;
-            nes->PC++;
-            break;
-        }
-
-        
-        case 0x9D: {
-            printf("STA at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes_write(nes, addr, nes->A);
-            nes->PC += 2;
-            break;
-        }
-
-        case 0x9E: { // SHX absolute,Y
-            printf("SHX absolute,Y at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t base_addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint16_t addr = base_addr + nes->Y;
-
-            uint8_t high_byte_plus_1 = ((addr >> 8) + 1) & 0xFF; // +1 comme le doc
-            uint8_t value = nes->X & high_byte_plus_1;
-
-            nes->ram[addr] = value;
-
-            break;
-        }
-
-        case 0xA0: {
-            printf("LDY #$%02X at PC=0x%04X\n", nes->ram[nes->PC], nes->PC);
-            nes->Y = nes_read(nes, nes->PC++);
-            
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->Y == 0) nes->P |= FLAG_Z;
-            if (nes->Y & 0x80) nes->P |= FLAG_N;
-            break;
-        }
-
-        case 0xA1: { // LDA (Indirect,X)
-            printf("LDA (Indirect,X) at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t zp_addr = nes_read(nes, nes->PC);
-            nes->PC++;
-
-            uint8_t addr_lo = nes->ram[(zp_addr + nes->X) & 0xFF];
-            uint8_t addr_hi = nes->ram[(zp_addr + nes->X + 1) & 0xFF];
-            uint16_t addr = addr_lo | (addr_hi << 8);
-
-
-            nes->A = nes_read(nes, addr);
-
-            // Update N, Z flags
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-        case 0xA2: { // LDX immediate
-            printf("LDX immediate at PC=0x%04X\n", nes->PC - 1);
-            nes->X = nes_read(nes, nes->PC);
-            nes->PC += 1;
-            
-            nes->P &= ~(FLAG_Z | FLAG_N); // Clear Z & N
-            if (nes->X == 0) nes->P |= FLAG_Z; // Set Z if 0
-            if (nes->X & FLAG_N) nes->P |= FLAG_N; // Set N if bit 7
-            break;
-        }
-
-        case 0xA3: {
-            printf("LAX (indirect,X) at PC=0x%04X\n", nes->PC - 1);
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t addr = nes->ram[(zp + nes->X) & 0xFF] | (nes->ram[(zp + nes->X + 1) & 0xFF] << 8);
-            uint8_t value = nes_read(nes, addr);
-            nes->A = value;
-            nes->X = value;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (value == 0) nes->P |= FLAG_Z;
-            if (value & 0x80) nes->P |= FLAG_N;
-            break;
-        }
-
-        case 0xA5: { // LDA zeropage
-            printf("LDA zeropage at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t addr = nes_read(nes, nes->PC++);
-            nes->A = nes->ram[addr];
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-        case 0xA6: { // LDX Zeropage
-            printf("LDX zeropage at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            nes->X = nes_read(nes, addr);
-            update_NZ_flags(nes, nes->X);
-            break;
-        }
-
-        case 0xA7: {
-            printf("LAX zeropage at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC++);
-            uint8_t value = nes->ram[addr];
-            nes->A = value;
-            nes->X = value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0xA8: { // TAY - Transfer Accumulator to Y
-            printf("TAY at PC=0x%04X, A=0x%02X\n", nes->PC - 1, nes->A);
-            nes->Y = nes->A;
-            update_NZ_flags(nes, nes->Y);
-            break;
-        }
-        
-        case 0xA9: { // LDA immediate
-            printf("LDA #$%02X at PC=0x%04X\n", nes_read(nes, nes->PC), nes->PC - 1);
-            nes->A = nes_read(nes, nes->PC);
-            nes->PC++;
-
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0xAA: { // TAX - Transfer Accumulator to X
-            printf("TAX at PC=0x%04X\n", nes->PC - 1);
-            nes->X = nes->A;
-            update_NZ_flags(nes, nes->X);
-            break;
-        }
-
-        case 0xAD: {
-            printf("LDA at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->A = nes_read(nes, addr);
-            nes->PC += 2;
-            break;
-        }
-
-        case 0xAF: {
-            printf("LAX absolute at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-            uint8_t value = nes_read(nes, addr);
-            nes->A = value;
-            nes->X = value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0xB0: {
-            printf("BCS at PC=0x%04X\n", nes->PC - 1);
-            int8_t offset = nes_read(nes, nes->PC);
-            nes->PC++;
-            if (nes->P & FLAG_C) { // if flag C = 1
-                nes->PC += offset; // jump
+// Decode [head, closing branch/JMP back to head]. Other branches must leave the loop.
+static bool cpu_idle_loop_scan(CPU *nes, uint16_t head, IdleLoop *loop) {
+    uint16_t pc = head;
+    uint16_t first_exit = 0xFFFF;  // Lowest forward branch target
+    int cycles = 0;
+    int count = 0;
+
+    while ((uint16_t)(pc - head) < IDLE_LOOP_MAX_BYTES) {
+        uint8_t opcode, lo = 0, hi = 0;
+        if (!cpu_idle_code_byte(nes, pc, &opcode)) return false;
+
+        const Opcode *op = &opcode_table[opcode];
+        int operand_size = addr_mode_size[op->mode];
+        if ((operand_size > 0 && !cpu_idle_code_byte(nes, pc + 1, &lo)) ||
+            (operand_size > 1 && !cpu_idle_code_byte(nes, pc + 2, &hi))) {
+            return false;
+        }
+        uint16_t next = pc + 1 + operand_size;
+        uint16_t operand = lo | (hi << 8);
+        count++;
+
+        if (op->mode == AM_REL) {
+            uint16_t target = next + (int8_t)lo;
+            if (target == head) {
+                loop->tail = 3 + (((next ^ target) & 0xFF00) ? 1 : 0);
+                cycles += loop->tail;
+                loop->closer = pc;
+                break;
             }
-            break;
-        }
-
-        case 0xB3: {
-            printf("LAX (indirect),Y at PC=0x%04X\n", nes->PC - 1);
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t base = nes->ram[zp] | (nes->ram[(zp + 1) & 0xFF] << 8);
-            uint16_t addr = base + nes->Y;
-            uint8_t value = nes_read(nes, addr);
-            nes->A = value;
-            nes->X = value;
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        // Zeropage,X - B5
-        case 0xB5: { // LDA zeropage,X
-            printf("LDA zeropage,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
-            nes->A = nes->ram[addr];
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-
-        case 0xB7: {
-            printf("LAX zeropage,Y at PC=0x%04X\n", nes->PC - 1);
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->Y) & 0xFF;
-            uint8_t value = nes->ram[addr];
-            nes->A = value;
-            nes->X = value;
-
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0xB8: { // CLV
-            printf("CLV at PC=0x%04X\n", nes->PC - 1);
-            nes->P &= ~0x40; // Clear Overflow flag (V = bit 6)
-            break;
-        }
-
-        case 0xB9: { // LDA absolute,Y
-            printf("LDA absolute,Y at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-            
-            uint16_t effective_addr = addr + nes->Y;
-
-            nes->A = nes_read(nes, effective_addr);
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-        case 0xBC: { // absolute, X
-            printf("LDY absolute,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint16_t effective_addr = addr + nes->X;
-            nes->Y = nes_read(nes, effective_addr);
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->Y == 0) nes->P |= FLAG_Z;
-            if (nes->Y & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0xBD: { // LDA absolute,X
-            printf("LDA absolute,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-            
-            uint16_t effective_addr = addr + nes->X;
-
-            nes->A = nes_read(nes, effective_addr);
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-        case 0xBF: {
-            printf("LAX absolute,Y at PC=0x%04X\n", nes->PC - 1);
-            uint16_t base = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-            uint16_t addr = base + nes->Y;
-            uint8_t value = nes_read(nes, addr);
-            nes->A = value;
-            nes->X = value;
-
-            update_NZ_flags(nes, nes->A);
-            break;
-        }
-
-        case 0xC0: { // CPY immediate
-            printf("CPY immediate at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t value = nes_read(nes, nes->PC++);
-            uint8_t result = nes->Y - value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N | FLAG_C);
-            if (nes->Y >= value) nes->P |= FLAG_C;
-            if (nes->Y == value) nes->P |= FLAG_Z;
-            if (result & 0x80)   nes->P |= FLAG_N;
-
-            break;
-        }
-
-
-        case 0xC3: {
-            printf("DCP at PC=0x%04X\n", nes->PC - 1);
-            uint8_t zp = nes_read(nes, nes->PC++);
-            uint16_t addr = nes->ram[(zp + nes->X) & 0xFF] | (nes->ram[(zp + nes->X + 1) & 0xFF] << 8);
-            nes->ram[addr] -= 1;
-            uint8_t value = nes->ram[addr];
-            uint16_t result = nes->A - value;
-
-            if (result & 0x80) nes->P |= FLAG_N; else nes->P &= ~FLAG_N;
-            if ((result & 0xFF) == 0) nes->P |= FLAG_Z; else nes->P &= ~FLAG_Z;
-            if (nes->A >= value) nes->P |= FLAG_C; else nes->P &= ~FLAG_C;
-            break;
-        }
-
-        case 0xC4: { // CPY zeropage
-            printf("CPY zeropage at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t addr = nes->ram[nes->PC++];
-            uint8_t value = nes_read(nes, addr);
-            uint8_t result = nes->Y - value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N | FLAG_C);
-            if (nes->Y >= value) nes->P |= FLAG_C;
-            if (nes->Y == value) nes->P |= FLAG_Z;
-            if (result & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-
-        case 0xC6: { // DEC zeropage
-            printf("DEC zeropage at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC); // 1 bytes
-            nes->PC += 1;
-
-            nes->ram[addr] -= 1;
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (nes->ram[addr] == 0) nes->P |= FLAG_Z;
-            if (nes->ram[addr] & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0xC7: { // DCP zeropage
-            printf("DCP zeropage at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t addr = nes_read(nes, nes->PC++);
-            nes->ram[addr] -= 1;
-            uint8_t value = nes->ram[addr];
-
-            uint16_t result = nes->A - value;
-
-            // Flags
-            if ((result & 0xFF) == 0) nes->P |= FLAG_Z; else nes->P &= ~FLAG_Z;
-            if (nes->A >= value) nes->P |= FLAG_C; else nes->P &= ~FLAG_C;
-            if (result & 0x80) nes->P |= FLAG_N; else nes->P &= ~FLAG_N;
-
-            break;
-        }
-
-        case 0xC8: { // INY
-            printf("INY at PC=0x%04X\n", nes->PC - 1);
-            nes->Y += 1;
-            update_NZ_flags(nes, nes->Y);
-            break;
-        }
-
-        case 0xC9: { // CMP immediate
-            uint8_t value = nes_read(nes, nes->PC); // get immediat operande
-            nes->PC++;
-
-            uint16_t result = nes->A - value;
-
-            // -- Update Flags --
-            if ((result & 0xFF) == 0)
-                nes->P |= FLAG_Z;  // Set Z
-            else
-                nes->P &= ~FLAG_Z; // Clear Z
-
-            if (nes->A >= value)
-                nes->P |= FLAG_C;  // Set C
-            else
-                nes->P &= ~FLAG_C; // Clear C
-
-            if (result & FLAG_N)
-                nes->P |= FLAG_N;  // Set N
-            else
-                nes->P &= ~FLAG_N; // Clear N
-
-            printf("CMP #$%02X at PC=0x%04X\n", value, nes->PC - 2);
-            break;
-        }
-
-        case 0xCA:
-            printf("DEX at PC=0x%04X\n", nes->PC - 1);
-            nes->X -= 1;
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (nes->X == 0) nes->P |= FLAG_Z;
-            if (nes->X & 0x80) nes->P |= FLAG_N;
-            nes->PC++;
-            break;
-
-        case 0xCB: { // SBX immediate
-            printf("SBX #oper at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t operand = nes_read(nes, nes->PC++);
-
-            uint16_t result = (nes->A & nes->X) - operand;
-            nes->X = result & 0xFF;
-
-            nes->P &= ~(FLAG_N | FLAG_Z | FLAG_C);
-            if (nes->X == 0) nes->P |= FLAG_Z;
-            if (nes->X & 0x80) nes->P |= FLAG_N;
-            if ((nes->A & nes->X) >= operand) nes->P |= FLAG_C; // C = A&X >= operand
-
-            break;
-        }
-
-        case 0xCC: { // CPY absolute
-            printf("CPY absolute at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            uint8_t value = nes_read(nes, addr);
-            uint8_t result = nes->Y - value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N | FLAG_C);
-            if (nes->Y >= value) nes->P |= FLAG_C;
-            if (nes->Y == value) nes->P |= FLAG_Z;
-            if (result & 0x80)   nes->P |= FLAG_N;
-
-            break;
-        }
-
-
-        case 0xCE: { // DEC absolute
-            printf("DEC absolute at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-
-            nes->ram[addr] -= 1;
-            uint8_t value = nes->ram[addr];
-
-            nes->P &= ~(FLAG_N | FLAG_Z);
-            if (value == 0) nes->P |= FLAG_Z;
-            if (value & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0xE0: {
-            printf("CPX #$%02X at PC=0x%04X\n", nes->prg_rom[nes->PC], nes->PC - 1);
-            uint8_t value = nes->prg_rom[nes->PC];
-            nes->PC += 1;
-
-            uint8_t result = nes->X - value;
-
-            if (nes->X >= value) {
-                nes->P |= FLAG_C;
-            } else {
-                nes->P &= ~FLAG_C;
+            if ((uint16_t)(target - head) < (uint16_t)(next - head)) {
+                return false;  // Inner backward branch
             }
-
-            update_NZ_flags(nes, result);
-            break;
-        }
-
-
-        case 0xE6: {
-            printf("INC at PC=0x%04X\n", nes->PC - 1);
-            uint8_t addr = nes_read(nes, nes->PC);
-            nes->ram[addr] += 1;
-            uint8_t value = nes->ram[addr];
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (value == 0) nes->P |= FLAG_Z;
-            if (value & FLAG_N) nes->P |= FLAG_N;
-            nes->PC++;
-            break;
-        }
-
-        case 0xE7: { // SBC Zero Page
-            uint8_t zp_addr = nes->prg_rom[nes->PC];
-            nes->PC += 1;
-
-            uint8_t value = nes_read(nes, zp_addr);
-            uint16_t temp = nes->A - value - (1 - ((nes->P & FLAG_C) ? 1 : 0));
-
-            printf("SBC $%02X at PC=0x%04X\n", zp_addr, nes->PC - 2);
-
-            nes->A = temp & 0xFF;
-
-            if (temp <= 0xFF)
-                nes->P |= FLAG_C;
-            else
-                nes->P &= ~FLAG_C;
-
-            update_NZ_flags(nes, nes->A);
-
-            break;
-        }
-
-
-        case 0xE8:
-            printf("INX at PC=0x%04X\n", nes->PC - 1);
-            nes->X += 1;
-            nes->P &= ~(FLAG_Z | FLAG_N);        // Clear Z and N
-            if (nes->X == 0) nes->P |= FLAG_Z; // Set Z if zero
-            if (nes->X & FLAG_N) nes->P |= FLAG_N; // Set N if bit 7
-            nes->PC++;
-            break;
-        
-        case 0xEA:
-            printf("NOP at PC=0x%04X\n", nes->PC - 1);
-            break;
-
-        case 0xEC: { // CPX absolute
-            uint16_t addr = nes->prg_rom[nes->PC] | (nes->prg_rom[nes->PC + 1] << 8);
-            nes->PC += 2;
-
-            uint8_t value = nes_read(nes, addr);
-            uint8_t result = nes->X - value;
-
-            printf("CPX $%04X at PC=0x%04X\n", addr, nes->PC - 3);
-
-            if (nes->X >= value)
-                nes->P |= FLAG_C;
-            else
-                nes->P &= ~FLAG_C;
-
-            update_NZ_flags(nes, result);
-            break;
-        }
-
-        
-        case 0xEE: {
-            printf("INC (absolute) at PC=0x%04X\n", nes->PC - 1);
-            uint16_t addr = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            uint8_t value = ++nes->ram[addr];
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (value == 0) nes->P |= FLAG_Z;  // Zero
-            if (value & FLAG_N) nes->P |= FLAG_N; // Negative
-            nes->PC += 2;
-            break;
-        }
-
-        case 0xD0: { // BNE — Branch if Not Equal (Z = 0)
-            printf("BNE at PC=0x%04X\n", nes->PC - 1);
-
-            int8_t offset = nes_read(nes, nes->PC++);
-            
-            if (!(nes->P & FLAG_Z)) {
-                nes->PC += offset;
+            if (target > pc && target < first_exit) first_exit = target;
+            cycles += op->cycles;  // Not taken while looping
+        } else if (op->op == OP_JMP && op->mode == AM_ABS && operand == head) {
+            loop->tail = op->cycles;
+            cycles += loop->tail;
+            loop->closer = pc;
+            break;
+        } else {
+            switch (op->op) {
+                case OP_LDA: case OP_LDX: case OP_LDY: case OP_BIT:
+                case OP_CMP: case OP_CPX: case OP_CPY:
+                case OP_AND: case OP_ORA: case OP_EOR: case OP_ADC: case OP_SBC:
+                    if (op->mode == AM_ZP || op->mode == AM_ABS) {
+                        if (!cpu_idle_read_is_pure(nes, op->mode == AM_ZP ? lo : operand)) return false;
+                    } else if (op->mode != AM_IMM) {
+                        return false;
+                    }
+                    break;
+
+                case OP_ASL: case OP_LSR: case OP_ROL: case OP_ROR:
+                    if (op->mode != AM_ACC) return false;
+                    break;
+
+                case OP_TAX: case OP_TAY: case OP_TXA: case OP_TYA: case OP_TSX: case OP_TXS:
+                case OP_INX: case OP_INY: case OP_DEX: case OP_DEY:
+                case OP_CLC: case OP_SEC: case OP_CLD: case OP_SED:
+                case OP_CLI: case OP_SEI: case OP_CLV:
+                    break;
+
+                case OP_NOP:
+                    if (opcode != 0xEA) return false;
+                    break;
+
+                default:
+                    return false;
             }
-
-            break;
-        }
-
-        case 0xD8:
-            printf("CLD at PC=0x%04X\n", nes->PC - 1);
-            nes->P &= ~FLAG_D;
-            break;
-
-        case 0xD9: { // CMP absolute,Y
-            printf("CMP absolute,Y at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t base = nes->ram[nes->PC] | (nes->ram[nes->PC + 1] << 8);
-            nes->PC += 2;
-
-            uint16_t addr = base + nes->Y;
-
-            uint8_t value = nes->ram[addr];
-
-            uint8_t result = nes->A - value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N | FLAG_C);
-            if (nes->A >= value) nes->P |= FLAG_C;
-            if (nes->A == value) nes->P |= FLAG_Z;
-            if (result & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-        case 0xDC: { // NOP absolute,X (illegal)
-            printf("NOP absolute,X at PC=0x%04X\n", nes->PC - 1);
-            nes->PC += 2;
-            break;
-        }
-
-        case 0xDD: { // CMP absolute,X
-            printf("CMP absolute,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint16_t base = nes->ram[nes->PC] | (nes->ram[nes->PC + 1] << 8);
-            nes->PC += 2;
-
-            uint16_t addr = base + nes->X;
-
-            uint8_t value = nes->ram[addr];
-
-            uint8_t result = nes->A - value;
-
-            nes->P &= ~(FLAG_Z | FLAG_N | FLAG_C);
-            if (nes->A >= value) nes->P |= FLAG_C;
-            if (nes->A == value) nes->P |= FLAG_Z;
-            if (result & 0x80) nes->P |= FLAG_N;
-
-            break;
-        }
-
-
-        case 0xF0: {
-            printf("BEQ at PC=0x%04X\n", nes->PC - 1);
-            int8_t offset = nes_read(nes, nes->PC);
-            nes->PC++;
-            if (nes->P & FLAG_Z)  // if flag Z = 1
-                nes->PC += offset; // jump
-            break;
+            cycles += op->cycles;
         }
+        pc = next;
+    }
 
-        case 0xF1: { // SBC ($nn),Y
-            printf("SBC ($nn),Y at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t zp_addr = nes_read(nes, nes->PC++);
-
-            uint16_t base = nes->ram[zp_addr] | (nes->ram[(zp_addr + 1) & 0xFF] << 8);
-            uint16_t addr = base + nes->Y;
-
-            uint8_t value = nes_read(nes, addr);
-
-            uint16_t result = nes->A - value - ((nes->P & 0x01) ? 0 : 1);
-
-            if (result < 0x100)
-                nes->P |= 0x01;
-            else
-                nes->P &= ~0x01;
-
-            uint8_t overflow = ((nes->A ^ result) & 0x80) && ((nes->A ^ value) & 0x80);
-            if (overflow)
-                nes->P |= 0x40;
-            else
-                nes->P &= ~0x40;
-
-            if ((result & 0xFF) == 0)
-                nes->P |= 0x02;
-            else
-                nes->P &= ~0x02;
+    if ((uint16_t)(pc - head) >= IDLE_LOOP_MAX_BYTES || first_exit <= pc) {
+        return false;
+    }
 
-            if (result & 0x80)
-                nes->P |= 0x80;
-            else
-                nes->P &= ~0x80;
+    loop->head = head;
+    loop->count = count;
+    loop->iteration = cycles;
+    return true;
+}
 
-            nes->A = (uint8_t)result;
-            break;
+IdleSkip cpu_idle_loop(CPU *nes, uint16_t from, uint64_t now, uint64_t end, int executed) {
+    IdleLoop *loop = &nes->idle;
+    uint16_t head = nes->PC;
+    IdleSkip skip = { 0, 0 };
+
+    if (!loop->armed || loop->head != head) {
+        if (loop->rejected == head) {
+            return skip;
+        }
+        loop->armed = cpu_idle_loop_scan(nes, head, loop);
+        if (!loop->armed) {
+            loop->rejected = head;
+            return skip;
+        }
+    } else if (!nes->nmi_pending &&
+               (uint16_t)(from - head) <= (uint16_t)(loop->closer - head) &&
+               now - loop->cycles == loop->iteration &&
+               executed - loop->executed == loop->count &&
+               nes->A == loop->a && nes->X == loop->x && nes->Y == loop->y &&
+               nes->P == loop->p && nes->SP == loop->sp) {
+        // Iterations that would start here and reach their closing branch
+        // before the budget runs out
+        int64_t room = (int64_t)(end - now) - (loop->iteration - loop->tail);
+        if (room > 0) {
+            uint64_t iterations = (room + loop->iteration - 1) / loop->iteration;
+            skip.cycles = iterations * loop->iteration;
+            skip.instructions = iterations * loop->count;
+            nes->idle_skipped += skip.cycles;
         }
+    }
 
-        case 0xF5: { // SBC zeropage,X
-            printf("SBC zeropage,X at PC=0x%04X\n", nes->PC - 1);
-
-            uint8_t zp_addr = nes_read(nes, nes->PC++);
-            uint8_t addr = (zp_addr + nes->X) & 0xFF;
-            uint8_t value = nes->ram[addr];
-
-            uint16_t result = nes->A - value - ((nes->P & 0x01) ? 0 : 1);
-
-            if (result < 0x100)
-                nes->P |= 0x01;
-            else
-                nes->P &= ~0x01;
-
-            uint8_t overflow = ((nes->A ^ result) & 0x80) && ((nes->A ^ value) & 0x80);
-            if (overflow)
-                nes->P |= 0x40;
-            else
-                nes->P &= ~0x40;
-
-            // flag Zero
-            if ((result & 0xFF) == 0)
-                nes->P |= 0x02;
-            else
-                nes->P &= ~0x02;
+    loop->a = nes->A;
+    loop->x = nes->X;
+    loop->y = nes->Y;
+    loop->p = nes->P;
+    loop->sp = nes->SP;
+    loop->cycles = now + skip.cycles;
+    loop->executed = executed + skip.instructions;
+    return skip;
+}
 
-            // flag Negative
-            if (result & 0x80)
-                nes->P |= 0x80;
-            else
-                nes->P &= ~0x80;
+// === Block cache ===
 
-            nes->A = (uint8_t)result;
-            break;
-        }
+void cpu_enable_block_cache(CPU *nes, bool enabled) {
+    if (enabled && !nes->block_cache) {
+        nes->block_cache = block_cache_create();
+    } else if (!enabled && nes->block_cache) {
+        cpu_enable_jit(nes, false);
+        block_cache_destroy(nes->block_cache);
+        nes->block_cache = NULL;
+    }
+}
 
-        case 0xF6: {  
-            printf("INC zeropage,X at PC=0x%04X\n", nes->PC - 1);
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
+bool cpu_enable_jit(CPU *nes, bool enabled) {
+    if (enabled && !nes->jit) {
+        if (!JIT_AVAILABLE) return false;
+        cpu_enable_block_cache(nes, true);
+        nes->jit = jit_create();
+        return nes->jit != NULL;
+    }
+    if (!enabled && nes->jit) {
+        jit_destroy(nes->jit);
+        nes->jit = NULL;
+    }
+    return true;
+}
 
-            nes->ram[addr] += 1;
-            uint8_t value = nes->ram[addr];
+#ifndef CPU_CORE_THREADED
+// Replay a predecoded block: only register-dependent addressing is left to do.
+// Stops early when the budget runs out, an NMI is pending or a write remapped
+// the block's page (block_cache_invalidate clears `valid` under our feet).
+static int cpu_run_block(CPU *nes, const Block *block, uint64_t end) {
+    int executed = 0;
 
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (value == 0) nes->P |= FLAG_Z;
-            if (value & 0x80) nes->P |= FLAG_N;
+    for (int i = 0; i < block->count && block->valid && nes->cycles < end && !nes->nmi_pending; i++) {
+        const DecodedInsn *insn = &block->insn[i];
+        uint16_t addr = insn->operand;
+        bool page_crossed = false;
 
-            break;
-        }
+        CPU_TRACE_INSTRUCTION(nes, nes->PC, insn->opcode);
+        nes->PC = insn->next_pc;
 
-        case 0xF7: { // ISC (Zeropage,X) - Increment then Subtract with Carry
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
-            nes->ram[addr] += 1;
-            uint8_t m = nes->ram[addr];
-            uint16_t result = nes->A - m - ((nes->P & FLAG_C) ? 0 : 1);
-            nes->P &= ~(FLAG_N | FLAG_Z | FLAG_C | FLAG_V);
-            if (result & 0x80) nes->P |= FLAG_N;
-            if ((result & 0xFF) == 0) nes->P |= FLAG_Z;
-            if (result < 0x100) nes->P |= FLAG_C;
-            if (((nes->A ^ result) & (0xFF ^ m) & 0x80) != 0) nes->P |= FLAG_V;
-            nes->A = result & 0xFF;
-            break;
-        }
+        switch (insn->mode) {
+            case AM_ZPX:
+                addr = (uint8_t)(insn->operand + nes->X);
+                break;
 
-        case 0xF8: { // SED — Set Decimal Flag
-            printf("SED at PC=0x%04X\n", nes->PC - 1);
+            case AM_ZPY:
+                addr = (uint8_t)(insn->operand + nes->Y);
+                break;
 
-            nes->P |= FLAG_D;
-            break;
-        }
+            case AM_ABX:
+                addr = insn->operand + nes->X;
+                page_crossed = (insn->operand ^ addr) & 0xFF00;
+                break;
 
-                
-        case 0xFC: { // NOP absolute,X (illegal)
-            printf("NOP absolute,X at PC=0x%04X\n", nes->PC - 1);
-            nes->PC += 2;
-            break;
-        }
+            case AM_ABY:
+                addr = insn->operand + nes->Y;
+                page_crossed = (insn->operand ^ addr) & 0xFF00;
+                break;
 
-        case 0xFE: {  
-            printf("INC absolute,X at PC=0x%04X\n", nes->PC - 1);
+            case AM_IND:
+                addr = nes_read(nes, insn->operand) |
+                       (nes_read(nes, (insn->operand & 0xFF00) | ((insn->operand + 1) & 0x00FF)) << 8);
+                break;
 
-            uint16_t base = nes_read(nes, nes->PC) | (nes_read(nes, nes->PC + 1) << 8);
-            nes->PC += 2;
-            uint16_t addr = base + nes->X;
+            case AM_IZX:
+                addr = cpu_read16_zp(nes, insn->operand + nes->X);
+                break;
 
-            nes->ram[addr] += 1;
-            uint8_t value = nes->ram[addr];
+            case AM_IZY: {
+                uint16_t base = cpu_read16_zp(nes, insn->operand);
+                addr = base + nes->Y;
+                page_crossed = (base ^ addr) & 0xFF00;
+                break;
+            }
 
-            nes->P &= ~(FLAG_Z | FLAG_N);
-            if (value == 0) nes->P |= FLAG_Z;
-            if (value & 0x80) nes->P |= FLAG_N;
+            case AM_REL:
+                page_crossed = (insn->next_pc ^ addr) & 0xFF00;
+                break;
 
-            break;
+            default:  // IMP, ACC, IMM, ZP, ABS: operand is the address
+                break;
         }
 
+        nes->cycles += cpu_operate(nes, insn->opcode, addr, page_crossed);
+        executed++;
+    }
+    return executed;
+}
 
-        case 0xFF: {  // ISC / ISB / INS zeropage,X
-            printf("ISC (zeropage,X) at PC=0x%04X\n", nes->PC - 1);
-
-            
-            uint8_t base = nes_read(nes, nes->PC++);
-            uint8_t addr = (base + nes->X) & 0xFF;
-
-            // INC M
-            nes->ram[addr] += 1;
-            uint8_t m = nes->ram[addr];
-
-            // SBC M (A = A - M - (1 - C))
-            uint16_t result = nes->A - m - ((nes->P & FLAG_C) ? 0 : 1);
-
-            // flags
-            nes->P &= ~(FLAG_N | FLAG_Z | FLAG_C | FLAG_V);
-            if (result & 0x80) nes->P |= FLAG_N;
-            if ((result & 0xFF) == 0) nes->P |= FLAG_Z;
-            if (result < 0x100) nes->P |= FLAG_C;
-            if (((nes->A ^ result) & (0xFF ^ m) & 0x80) != 0) nes->P |= FLAG_V;
-
-            nes->A = result & 0xFF;
-
-            break;
+// Reference core: one switch dispatch per instruction, or whole predecoded
+// blocks when the block cache is enabled and PC is in PRG-ROM (native code
+// once they are hot, with the JIT)
+int cpu_execute(CPU *nes, int cycle_budget) {
+    uint64_t end = nes->cycles + cycle_budget;
+    int executed = 0;
+
+    nes->idle.armed = false;  // An NMI may have run since the last call
+
+    while (nes->cycles < end) {
+        if (nes->nmi_pending) {
+            cpu_take_nmi(nes);
+        }
+
+        uint16_t pc = nes->PC;
+        Block *block = nes->block_cache
+                     ? block_cache_lookup(nes->block_cache, nes, pc)
+                     : NULL;
+        if (block) {
+            int native = 0;
+#if JIT_AVAILABLE
+            // Native code has no trace hook
+            if (nes->jit && !nes->trace) native = jit_run_block(nes->jit, nes, block, end);
+#endif
+            executed += native ? native : cpu_run_block(nes, block, end);
+        } else {
+            nes_emulation_cycle(nes);
+            executed++;
+        }
+
+        // Jumped back: maybe a polling loop
+        if (nes->PC <= pc && nes->idle_skip && !nes->trace) {
+            IdleSkip skip = cpu_idle_loop(nes, pc, nes->cycles, end, executed);
+            nes->cycles += skip.cycles;
+            executed += skip.instructions;
         }
-
-        case 0x02: 
-        case 0x12: 
-        case 0x22: 
-        case 0x32:
-        case 0x42: 
-        case 0x52: 
-        case 0x62: 
-        case 0x72:
-        case 0x92: 
-        case 0xB2: 
-        case 0xD2: 
-        case 0xF2:
-            printf("⚠️ JAM opcode 0x%02X at PC=0x%04X, skipping\n", opcode, nes->PC - 1);
-            nes->PC++; // jmp instruc so as not to block
-            break;
-
-        
-        default:
-            printf("❌ Unimplemented opcode: %02X at PC=0x%04X\n", opcode, nes->PC - 1);
-            exit(1);
-
     }
-
-}
\ No newline at end of file
+    return executed;
+}
+#endif
@@ -0,0 +1,639 @@
+/*
+=== THREADED CORE ===
+Alternative to the switch in nes_emulation_cycle, built with -DCPU_CORE_THREADED
+(make CORE=threaded). Each opcode gets its own label, specialised from the shared
+addressing-mode (ADDR_*) and operation (EXEC_*) macros, and jumps straight to the
+next opcode through a label table (GCC labels-as-values). CPU registers live in
+locals for the whole cpu_execute() call, and so does the cycle count, published
+to CPU::cycles before every PPU/I/O handler access.
+
+Results must stay identical to the reference core: same bus accesses in the same
+order, same cycle counts.
+*/
+
+#ifdef CPU_CORE_THREADED
+
+#if !defined(__GNUC__)
+#error "The threaded CPU core needs GCC/Clang labels-as-values"
+#endif
+
+#include <stdio.h>
+#include "../includes/cpu.h"
+#ifdef CPU_TRACE
+#include "../includes/opcodes.h"
+#include "../includes/trace.h"
+#endif
+
+// === Bus ===
+// Mapped pages are plain loads and stores. Handler pages (PPU registers, I/O)
+// catch up on CPU::cycles, so the cycles counted locally since the last call
+// are published first, and the budget is taken back from CPU::cycles after the
+// call: an OAM DMA stall lands there and must end the burst like any cycle, and
+// so does an NMI the PPU raised on the way (taken on the next call, once the
+// locals are written back).
+#define IO_BEGIN()   (nes->cycles += cycles, cycles = 0)
+#define IO_END()     (cycle_budget = nes->cycles < end && !nes->nmi_pending \
+                                   ? (int)(end - nes->cycles) : 0)
+#define READ(a) ({                                                      \
+        uint16_t bus_ = (a);                                            \
+        const uint8_t *map_ = nes->read_map[bus_ >> CPU_PAGE_SHIFT];    \
+        map_ ? map_[bus_ & 0xFF] : ({                                   \
+            IO_BEGIN();                                                 \
+            uint8_t io_ = nes->read_handler[bus_ >> CPU_PAGE_SHIFT](nes, bus_); \
+            IO_END();                                                   \
+            io_;                                                        \
+        });                                                             \
+    })
+#define WRITE(a, v)                                                     \
+    do {                                                                \
+        uint16_t bus_ = (a);                                            \
+        uint8_t value_ = (v);                                           \
+        uint8_t *map_ = nes->write_map[bus_ >> CPU_PAGE_SHIFT];         \
+        if (map_) {                                                     \
+            map_[bus_ & 0xFF] = value_;                                 \
+        } else {                                                        \
+            IO_BEGIN();                                                 \
+            nes->write_handler[bus_ >> CPU_PAGE_SHIFT](nes, bus_, value_); \
+            IO_END();                                                   \
+        }                                                               \
+    } while (0)
+#define FETCH()      READ(PC++)
+#define PUSH(v)      (nes->ram[0x0100 + SP--] = (v))
+#define PULL()       (nes->ram[0x0100 + ++SP])
+
+#define SET_NZ(v)    (P = (P & ~(FLAG_N | FLAG_Z)) | ((v) & FLAG_N) | ((v) == 0 ? FLAG_Z : 0))
+
+// === Addressing modes ===
+#define ADDR_IMP
+#define ADDR_IMM     addr = PC++;
+#define ADDR_ZP      addr = FETCH();
+#define ADDR_ZPX     addr = (uint8_t)(FETCH() + X);
+#define ADDR_ZPY     addr = (uint8_t)(FETCH() + Y);
+#define ADDR_ABS     addr = READ(PC) | (READ(PC + 1) << 8); PC += 2;
+#define ADDR_INDEXED(reg) {                                             \
+        uint16_t base = READ(PC) | (READ(PC + 1) << 8);                 \
+        PC += 2;                                                        \
+        addr = base + (reg);                                            \
+        cross = ((base ^ addr) & 0xFF00) != 0;                          \
+    }
+#define ADDR_ABX     ADDR_INDEXED(X)
+#define ADDR_ABY     ADDR_INDEXED(Y)
+#define ADDR_IND {                                                      \
+        uint16_t ptr = READ(PC) | (READ(PC + 1) << 8);                  \
+        PC += 2;                                                        \
+        addr = READ(ptr) | (READ((ptr & 0xFF00) | ((ptr + 1) & 0x00FF)) << 8); \
+    }
+#define ADDR_IZX {                                                      \
+        uint8_t zp = FETCH() + X;                                       \
+        addr = READ(zp) | (READ((uint8_t)(zp + 1)) << 8);               \
+    }
+#define ADDR_IZY {                                                      \
+        uint8_t zp = FETCH();                                           \
+        uint16_t base = READ(zp) | (READ((uint8_t)(zp + 1)) << 8);      \
+        addr = base + Y;                                                \
+        cross = ((base ^ addr) & 0xFF00) != 0;                          \
+    }
+#define ADDR_REL {                                                      \
+        int8_t offset = FETCH();                                        \
+        addr = PC + offset;                                             \
+        cross = ((PC ^ addr) & 0xFF00) != 0;                            \
+    }
+
+// === Read-modify-write ===
+// body works on the local v. Zero-page modes take the RAM shortcut, other modes
+// modify RAM pages in place and fall back to read / dummy write / write.
+#define RMW_BUS(body) {                                                 \
+        uint8_t *page_ = nes->write_map[addr >> CPU_PAGE_SHIFT];        \
+        if (page_ && page_ == nes->read_map[addr >> CPU_PAGE_SHIFT]) {  \
+            uint8_t v = page_[addr & 0xFF];                             \
+            body;                                                       \
+            page_[addr & 0xFF] = v;                                     \
+        } else {                                                        \
+            uint8_t v = READ(addr);                                     \
+            WRITE(addr, v);                                             \
+            body;                                                       \
+            WRITE(addr, v);                                             \
+        }                                                               \
+    }
+#define RMW_ZEROPAGE(body) {                                            \
+        if (nes->write_map[0]) {                                        \
+            uint8_t v = nes->ram[addr];                                 \
+            body;                                                       \
+            nes->ram[addr] = v;                                         \
+        } else RMW_BUS(body)                                            \
+    }
+#define RMW_ZP(body)  RMW_ZEROPAGE(body)
+#define RMW_ZPX(body) RMW_ZEROPAGE(body)
+#define RMW_ABS(body) RMW_BUS(body)
+#define RMW_ABX(body) RMW_BUS(body)
+#define RMW_ABY(body) RMW_BUS(body)
+#define RMW_IZX(body) RMW_BUS(body)
+#define RMW_IZY(body) RMW_BUS(body)
+
+// === ALU ===
+#define DO_ADC(value) {                                                 \
+        uint8_t v_ = (value);                                           \
+        uint16_t sum_ = A + v_ + (P & FLAG_C);                          \
+        P = (P & ~(FLAG_C | FLAG_V)) | (sum_ > 0xFF ? FLAG_C : 0) |     \
+            (((A ^ sum_) & (v_ ^ sum_) & 0x80) ? FLAG_V : 0);           \
+        A = (uint8_t)sum_;                                              \
+        SET_NZ(A);                                                      \
+    }
+#define DO_SBC(value)  DO_ADC((uint8_t)~(value))
+#define DO_CMP(reg, value) {                                            \
+        uint8_t v_ = (value);                                           \
+        P = (P & ~FLAG_C) | ((reg) >= v_ ? FLAG_C : 0);                 \
+        SET_NZ((uint8_t)((reg) - v_));                                  \
+    }
+#define DO_ASL(r)  { P = (P & ~FLAG_C) | ((r) >> 7); (r) <<= 1; SET_NZ(r); }
+#define DO_LSR(r)  { P = (P & ~FLAG_C) | ((r) & 0x01); (r) >>= 1; SET_NZ(r); }
+#define DO_ROL(r)  { uint8_t c_ = P & FLAG_C; P = (P & ~FLAG_C) | ((r) >> 7); \
+                     (r) = ((r) << 1) | c_; SET_NZ(r); }
+#define DO_ROR(r)  { uint8_t c_ = (P & FLAG_C) << 7; P = (P & ~FLAG_C) | ((r) & 0x01); \
+                     (r) = ((r) >> 1) | c_; SET_NZ(r); }
+
+// Backward jump: let cpu_idle_loop look for a polling loop. The opcode's base
+// cycles are only added after EXEC, hence `base`.
+#define IDLE_LOOP(from, base)                                               \
+    if (PC <= (from) && nes->idle_skip && !nes->trace) {                    \
+        nes->A = A; nes->X = X; nes->Y = Y; nes->P = P; nes->SP = SP;       \
+        nes->PC = PC;                                                       \
+        IdleSkip skip_ = cpu_idle_loop(nes, (from), nes->cycles + cycles + (base), \
+                                       end, executed);                      \
+        cycles += skip_.cycles;                                             \
+        executed += skip_.instructions;                                     \
+    }
+
+#define BRANCH(cond)                                                    \
+    if (cond) {                                                         \
+        uint16_t from_ = PC - 2;                                        \
+        PC = addr;                                                      \
+        cycles += 1 + cross;                                            \
+        IDLE_LOOP(from_, 2)                                             \
+    }
+
+// === Operations ===
+#define EXEC_LDA(m)  A = READ(addr); SET_NZ(A);
+#define EXEC_LDX(m)  X = READ(addr); SET_NZ(X);
+#define EXEC_LDY(m)  Y = READ(addr); SET_NZ(Y);
+#define EXEC_STA(m)  WRITE(addr, A);
+#define EXEC_STX(m)  WRITE(addr, X);
+#define EXEC_STY(m)  WRITE(addr, Y);
+
+#define EXEC_TAX(m)  X = A; SET_NZ(X);
+#define EXEC_TAY(m)  Y = A; SET_NZ(Y);
+#define EXEC_TXA(m)  A = X; SET_NZ(A);
+#define EXEC_TYA(m)  A = Y; SET_NZ(A);
+#define EXEC_TSX(m)  X = SP; SET_NZ(X);
+#define EXEC_TXS(m)  SP = X;
+
+#define EXEC_PHA(m)  PUSH(A);
+#define EXEC_PHP(m)  PUSH(P | FLAG_B | FLAG_U);
+#define EXEC_PLA(m)  A = PULL(); SET_NZ(A);
+#define EXEC_PLP(m)  P = (PULL() & ~FLAG_B) | FLAG_U;
+
+#define EXEC_AND(m)  A &= READ(addr); SET_NZ(A);
+#define EXEC_ORA(m)  A |= READ(addr); SET_NZ(A);
+#define EXEC_EOR(m)  A ^= READ(addr); SET_NZ(A);
+#define EXEC_ADC(m)  DO_ADC(READ(addr))
+#define EXEC_SBC(m)  DO_SBC(READ(addr))
+#define EXEC_CMP(m)  DO_CMP(A, READ(addr))
+#define EXEC_CPX(m)  DO_CMP(X, READ(addr))
+#define EXEC_CPY(m)  DO_CMP(Y, READ(addr))
+#define EXEC_BIT(m) {                                                   \
+        uint8_t v_ = READ(addr);                                        \
+        P = (P & ~(FLAG_Z | FLAG_V | FLAG_N)) | (v_ & (FLAG_V | FLAG_N)) | \
+            ((A & v_) ? 0 : FLAG_Z);                                    \
+    }
+
+#define EXEC_INX(m)  X++; SET_NZ(X);
+#define EXEC_INY(m)  Y++; SET_NZ(Y);
+#define EXEC_DEX(m)  X--; SET_NZ(X);
+#define EXEC_DEY(m)  Y--; SET_NZ(Y);
+#define EXEC_INC(m)  RMW_##m(v++; SET_NZ(v))
+#define EXEC_DEC(m)  RMW_##m(v--; SET_NZ(v))
+
+#define EXEC_ASL_A(m) DO_ASL(A)
+#define EXEC_LSR_A(m) DO_LSR(A)
+#define EXEC_ROL_A(m) DO_ROL(A)
+#define EXEC_ROR_A(m) DO_ROR(A)
+#define EXEC_ASL(m)  RMW_##m(DO_ASL(v))
+#define EXEC_LSR(m)  RMW_##m(DO_LSR(v))
+#define EXEC_ROL(m)  RMW_##m(DO_ROL(v))
+#define EXEC_ROR(m)  RMW_##m(DO_ROR(v))
+
+#define EXEC_JMP(m)  JMP_##m
+#define JMP_ABS      { uint16_t from_ = PC - 3; PC = addr; IDLE_LOOP(from_, 3) }
+#define JMP_IND      PC = addr;
+#define EXEC_JSR(m)  PUSH((uint16_t)(PC - 1) >> 8); PUSH((PC - 1) & 0xFF); PC = addr;
+#define EXEC_RTS(m)  { uint8_t pcl_ = PULL(); PC = ((PULL() << 8) | pcl_) + 1; }
+#define EXEC_RTI(m)  { P = (PULL() & ~FLAG_B) | FLAG_U;                 \
+                       uint8_t pcl_ = PULL(); PC = (PULL() << 8) | pcl_; }
+#define EXEC_BRK(m)  PUSH((uint16_t)(PC + 1) >> 8); PUSH((PC + 1) & 0xFF); \
+                     PUSH(P | FLAG_B | FLAG_U); P |= FLAG_I;            \
+                     PC = READ(0xFFFE) | (READ(0xFFFF) << 8);
+
+#define EXEC_BPL(m)  BRANCH(!(P & FLAG_N))
+#define EXEC_BMI(m)  BRANCH(P & FLAG_N)
+#define EXEC_BVC(m)  BRANCH(!(P & FLAG_V))
+#define EXEC_BVS(m)  BRANCH(P & FLAG_V)
+#define EXEC_BCC(m)  BRANCH(!(P & FLAG_C))
+#define EXEC_BCS(m)  BRANCH(P & FLAG_C)
+#define EXEC_BNE(m)  BRANCH(!(P & FLAG_Z))
+#define EXEC_BEQ(m)  BRANCH(P & FLAG_Z)
+
+#define EXEC_CLC(m)  P &= ~FLAG_C;
+#define EXEC_CLD(m)  P &= ~FLAG_D;
+#define EXEC_CLI(m)  P &= ~FLAG_I;
+#define EXEC_CLV(m)  P &= ~FLAG_V;
+#define EXEC_SEC(m)  P |= FLAG_C;
+#define EXEC_SED(m)  P |= FLAG_D;
+#define EXEC_SEI(m)  P |= FLAG_I;
+#define EXEC_NOP(m)
+
+// Illegal opcodes, same semantics as the reference core
+#define EXEC_SLO(m)  RMW_##m(DO_ASL(v); A |= v; SET_NZ(A))
+#define EXEC_RLA(m)  RMW_##m(DO_ROL(v); A &= v; SET_NZ(A))
+#define EXEC_SRE(m)  RMW_##m(DO_LSR(v); A ^= v; SET_NZ(A))
+#define EXEC_RRA(m)  RMW_##m(DO_ROR(v); DO_ADC(v))
+#define EXEC_DCP(m)  RMW_##m(v--; DO_CMP(A, v))
+#define EXEC_ISC(m)  RMW_##m(v++; DO_SBC(v))
+#define EXEC_SAX(m)  WRITE(addr, A & X);
+#define EXEC_LAX(m)  A = X = READ(addr); SET_NZ(A);
+#define EXEC_LAS(m)  A = X = SP = READ(addr) & SP; SET_NZ(A);
+#define EXEC_ANC(m)  A &= READ(addr); SET_NZ(A); P = (P & ~FLAG_C) | (A >> 7);
+#define EXEC_ALR(m)  A &= READ(addr); DO_LSR(A)
+#define EXEC_ARR(m)  A = ((A & READ(addr)) >> 1) | ((P & FLAG_C) << 7); SET_NZ(A); \
+                     P = (P & ~(FLAG_C | FLAG_V)) | ((A >> 6) & FLAG_C) | \
+                         ((((A >> 6) ^ (A >> 5)) & 0x01) ? FLAG_V : 0);
+#define EXEC_SBX(m)  { uint8_t v_ = READ(addr); uint8_t ax_ = A & X;   \
+                       P = (P & ~FLAG_C) | (ax_ >= v_ ? FLAG_C : 0);    \
+                       X = ax_ - v_; SET_NZ(X); }
+#define EXEC_XAA(m)  A = (A | 0xEE) & X & READ(addr); SET_NZ(A);
+#define EXEC_SHA(m)  WRITE(addr, A & X & ((addr >> 8) + 1));
+#define EXEC_SHX(m)  WRITE(addr, X & ((addr >> 8) + 1));
+#define EXEC_SHY(m)  WRITE(addr, Y & ((addr >> 8) + 1));
+#define EXEC_TAS(m)  SP = A & X; WRITE(addr, SP & ((addr >> 8) + 1));
+#define EXEC_JAM(m)  printf("⚠️ JAM opcode 0x%02X at PC=0x%04X, skipping\n", opcode, PC - 1); \
+                     PC++;
+
+// One label per opcode: address, operate, count cycles, dispatch the next one
+#define OPCODE(code, mode, op, cyc, penalty)                            \
+    op_##code:                                                          \
+        ADDR_##mode                                                     \
+        EXEC_##op(mode)                                                 \
+        cycles += (cyc) + ((penalty) ? cross : 0);                      \
+        NEXT();
+
+#ifdef CPU_TRACE
+static void cpu_trace_threaded(CPU *nes, uint64_t cycle, uint16_t pc, uint8_t a, uint8_t x,
+                               uint8_t y, uint8_t p, uint8_t sp) {
+    uint8_t opcode = cpu_bus_read(nes, pc);
+    uint8_t size = addr_mode_size[opcode_table[opcode].mode];
+    TraceRecord record = { .cycle = cycle, .pc = pc, .opcode = opcode,
+                           .a = a, .x = x, .y = y, .p = p, .sp = sp };
+    for (int i = 0; i < size; i++) {
+        uint16_t addr = pc + 1 + i;
+        record.operand[i] = (addr >= 0x2000 && addr < 0x4020) ? 0 : cpu_bus_read(nes, addr);
+    }
+    trace_push(nes->trace, &record);
+}
+#define TRACE_HOOK() \
+    do { if (nes->trace) cpu_trace_threaded(nes, nes->cycles + cycles, PC, A, X, Y, P, SP); } while (0)
+#else
+#define TRACE_HOOK() ((void)0)
+#endif
+
+#define NEXT()                                                          \
+    do {                                                                \
+        if (cycles >= cycle_budget) goto done;                          \
+        TRACE_HOOK();                                                   \
+        executed++;                                                     \
+        opcode = FETCH();                                               \
+        cross = 0;                                                      \
+        goto *dispatch[opcode];                                         \
+    } while (0)
+
+int cpu_execute(CPU *nes, int cycle_budget) {
+    static const void *const dispatch[256] = {
+        &&op_00, &&op_01, &&op_02, &&op_03, &&op_04, &&op_05, &&op_06, &&op_07,
+        &&op_08, &&op_09, &&op_0A, &&op_0B, &&op_0C, &&op_0D, &&op_0E, &&op_0F,
+        &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15, &&op_16, &&op_17,
+        &&op_18, &&op_19, &&op_1A, &&op_1B, &&op_1C, &&op_1D, &&op_1E, &&op_1F,
+        &&op_20, &&op_21, &&op_22, &&op_23, &&op_24, &&op_25, &&op_26, &&op_27,
+        &&op_28, &&op_29, &&op_2A, &&op_2B, &&op_2C, &&op_2D, &&op_2E, &&op_2F,
+        &&op_30, &&op_31, &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37,
+        &&op_38, &&op_39, &&op_3A, &&op_3B, &&op_3C, &&op_3D, &&op_3E, &&op_3F,
+        &&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47,
+        &&op_48, &&op_49, &&op_4A, &&op_4B, &&op_4C, &&op_4D, &&op_4E, &&op_4F,
+        &&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55, &&op_56, &&op_57,
+        &&op_58, &&op_59, &&op_5A, &&op_5B, &&op_5C, &&op_5D, &&op_5E, &&op_5F,
+        &&op_60, &&op_61, &&op_62, &&op_63, &&op_64, &&op_65, &&op_66, &&op_67,
+        &&op_68, &&op_69, &&op_6A, &&op_6B, &&op_6C, &&op_6D, &&op_6E, &&op_6F,
+        &&op_70, &&op_71, &&op_72, &&op_73, &&op_74, &&op_75, &&op_76, &&op_77,
+        &&op_78, &&op_79, &&op_7A, &&op_7B, &&op_7C, &&op_7D, &&op_7E, &&op_7F,
+        &&op_80, &&op_81, &&op_82, &&op_83, &&op_84, &&op_85, &&op_86, &&op_87,
+        &&op_88, &&op_89, &&op_8A, &&op_8B, &&op_8C, &&op_8D, &&op_8E, &&op_8F,
+        &&op_90, &&op_91, &&op_92, &&op_93, &&op_94, &&op_95, &&op_96, &&op_97,
+        &&op_98, &&op_99, &&op_9A, &&op_9B, &&op_9C, &&op_9D, &&op_9E, &&op_9F,
+        &&op_A0, &&op_A1, &&op_A2, &&op_A3, &&op_A4, &&op_A5, &&op_A6, &&op_A7,
+        &&op_A8, &&op_A9, &&op_AA, &&op_AB, &&op_AC, &&op_AD, &&op_AE, &&op_AF,
+        &&op_B0, &&op_B1, &&op_B2, &&op_B3, &&op_B4, &&op_B5, &&op_B6, &&op_B7,
+        &&op_B8, &&op_B9, &&op_BA, &&op_BB, &&op_BC, &&op_BD, &&op_BE, &&op_BF,
+        &&op_C0, &&op_C1, &&op_C2, &&op_C3, &&op_C4, &&op_C5, &&op_C6, &&op_C7,
+        &&op_C8, &&op_C9, &&op_CA, &&op_CB, &&op_CC, &&op_CD, &&op_CE, &&op_CF,
+        &&op_D0, &&op_D1, &&op_D2, &&op_D3, &&op_D4, &&op_D5, &&op_D6, &&op_D7,
+        &&op_D8, &&op_D9, &&op_DA, &&op_DB, &&op_DC, &&op_DD, &&op_DE, &&op_DF,
+        &&op_E0, &&op_E1, &&op_E2, &&op_E3, &&op_E4, &&op_E5, &&op_E6, &&op_E7,
+        &&op_E8, &&op_E9, &&op_EA, &&op_EB, &&op_EC, &&op_ED, &&op_EE, &&op_EF,
+        &&op_F0, &&op_F1, &&op_F2, &&op_F3, &&op_F4, &&op_F5, &&op_F6, &&op_F7,
+        &&op_F8, &&op_F9, &&op_FA, &&op_FB, &&op_FC, &&op_FD, &&op_FE, &&op_FF,
+    };
+
+    uint64_t end = nes->cycles + cycle_budget;
+    if (nes->nmi_pending) {
+        cpu_take_nmi(nes);  // Its 7 cycles come out of this budget
+        IO_END();
+    }
+
+    uint8_t A = nes->A, X = nes->X, Y = nes->Y, P = nes->P, SP = nes->SP;
+    uint16_t PC = nes->PC;
+    uint16_t addr = 0;
+    uint8_t opcode;
+    int cross;
+    int cycles = 0;
+    int executed = 0;
+
+    nes->idle.armed = false;  // An NMI may have run since the last call
+
+    NEXT();
+
+    OPCODE(00, IMP, BRK, 7, 0)
+    OPCODE(01, IZX, ORA, 6, 0)
+    OPCODE(02, IMP, JAM, 2, 0)
+    OPCODE(03, IZX, SLO, 8, 0)
+    OPCODE(04, ZP, NOP, 3, 0)
+    OPCODE(05, ZP, ORA, 3, 0)
+    OPCODE(06, ZP, ASL, 5, 0)
+    OPCODE(07, ZP, SLO, 5, 0)
+    OPCODE(08, IMP, PHP, 3, 0)
+    OPCODE(09, IMM, ORA, 2, 0)
+    OPCODE(0A, IMP, ASL_A, 2, 0)
+    OPCODE(0B, IMM, ANC, 2, 0)
+    OPCODE(0C, ABS, NOP, 4, 0)
+    OPCODE(0D, ABS, ORA, 4, 0)
+    OPCODE(0E, ABS, ASL, 6, 0)
+    OPCODE(0F, ABS, SLO, 6, 0)
+    OPCODE(10, REL, BPL, 2, 0)
+    OPCODE(11, IZY, ORA, 5, 1)
+    OPCODE(12, IMP, JAM, 2, 0)
+    OPCODE(13, IZY, SLO, 8, 0)
+    OPCODE(14, ZPX, NOP, 4, 0)
+    OPCODE(15, ZPX, ORA, 4, 0)
+    OPCODE(16, ZPX, ASL, 6, 0)
+    OPCODE(17, ZPX, SLO, 6, 0)
+    OPCODE(18, IMP, CLC, 2, 0)
+    OPCODE(19, ABY, ORA, 4, 1)
+    OPCODE(1A, IMP, NOP, 2, 0)
+    OPCODE(1B, ABY, SLO, 7, 0)
+    OPCODE(1C, ABX, NOP, 4, 1)
+    OPCODE(1D, ABX, ORA, 4, 1)
+    OPCODE(1E, ABX, ASL, 7, 0)
+    OPCODE(1F, ABX, SLO, 7, 0)
+    OPCODE(20, ABS, JSR, 6, 0)
+    OPCODE(21, IZX, AND, 6, 0)
+    OPCODE(22, IMP, JAM, 2, 0)
+    OPCODE(23, IZX, RLA, 8, 0)
+    OPCODE(24, ZP, BIT, 3, 0)
+    OPCODE(25, ZP, AND, 3, 0)
+    OPCODE(26, ZP, ROL, 5, 0)
+    OPCODE(27, ZP, RLA, 5, 0)
+    OPCODE(28, IMP, PLP, 4, 0)
+    OPCODE(29, IMM, AND, 2, 0)
+    OPCODE(2A, IMP, ROL_A, 2, 0)
+    OPCODE(2B, IMM, ANC, 2, 0)
+    OPCODE(2C, ABS, BIT, 4, 0)
+    OPCODE(2D, ABS, AND, 4, 0)
+    OPCODE(2E, ABS, ROL, 6, 0)
+    OPCODE(2F, ABS, RLA, 6, 0)
+    OPCODE(30, REL, BMI, 2, 0)
+    OPCODE(31, IZY, AND, 5, 1)
+    OPCODE(32, IMP, JAM, 2, 0)
+    OPCODE(33, IZY, RLA, 8, 0)
+    OPCODE(34, ZPX, NOP, 4, 0)
+    OPCODE(35, ZPX, AND, 4, 0)
+    OPCODE(36, ZPX, ROL, 6, 0)
+    OPCODE(37, ZPX, RLA, 6, 0)
+    OPCODE(38, IMP, SEC, 2, 0)
+    OPCODE(39, ABY, AND, 4, 1)
+    OPCODE(3A, IMP, NOP, 2, 0)
+    OPCODE(3B, ABY, RLA, 7, 0)
+    OPCODE(3C, ABX, NOP, 4, 1)
+    OPCODE(3D, ABX, AND, 4, 1)
+    OPCODE(3E, ABX, ROL, 7, 0)
+    OPCODE(3F, ABX, RLA, 7, 0)
+    OPCODE(40, IMP, RTI, 6, 0)
+    OPCODE(41, IZX, EOR, 6, 0)
+    OPCODE(42, IMP, JAM, 2, 0)
+    OPCODE(43, IZX, SRE, 8, 0)
+    OPCODE(44, ZP, NOP, 3, 0)
+    OPCODE(45, ZP, EOR, 3, 0)
+    OPCODE(46, ZP, LSR, 5, 0)
+    OPCODE(47, ZP, SRE, 5, 0)
+    OPCODE(48, IMP, PHA, 3, 0)
+    OPCODE(49, IMM, EOR, 2, 0)
+    OPCODE(4A, IMP, LSR_A, 2, 0)
+    OPCODE(4B, IMM, ALR, 2, 0)
+    OPCODE(4C, ABS, JMP, 3, 0)
+    OPCODE(4D, ABS, EOR, 4, 0)
+    OPCODE(4E, ABS, LSR, 6, 0)
+    OPCODE(4F, ABS, SRE, 6, 0)
+    OPCODE(50, REL, BVC, 2, 0)
+    OPCODE(51, IZY, EOR, 5, 1)
+    OPCODE(52, IMP, JAM, 2, 0)
+    OPCODE(53, IZY, SRE, 8, 0)
+    OPCODE(54, ZPX, NOP, 4, 0)
+    OPCODE(55, ZPX, EOR, 4, 0)
+    OPCODE(56, ZPX, LSR, 6, 0)
+    OPCODE(57, ZPX, SRE, 6, 0)
+    OPCODE(58, IMP, CLI, 2, 0)
+    OPCODE(59, ABY, EOR, 4, 1)
+    OPCODE(5A, IMP, NOP, 2, 0)
+    OPCODE(5B, ABY, SRE, 7, 0)
+    OPCODE(5C, ABX, NOP, 4, 1)
+    OPCODE(5D, ABX, EOR, 4, 1)
+    OPCODE(5E, ABX, LSR, 7, 0)
+    OPCODE(5F, ABX, SRE, 7, 0)
+    OPCODE(60, IMP, RTS, 6, 0)
+    OPCODE(61, IZX, ADC, 6, 0)
+    OPCODE(62, IMP, JAM, 2, 0)
+    OPCODE(63, IZX, RRA, 8, 0)
+    OPCODE(64, ZP, NOP, 3, 0)
+    OPCODE(65, ZP, ADC, 3, 0)
+    OPCODE(66, ZP, ROR, 5, 0)
+    OPCODE(67, ZP, RRA, 5, 0)
+    OPCODE(68, IMP, PLA, 4, 0)
+    OPCODE(69, IMM, ADC, 2, 0)
+    OPCODE(6A, IMP, ROR_A, 2, 0)
+    OPCODE(6B, IMM, ARR, 2, 0)
+    OPCODE(6C, IND, JMP, 5, 0)
+    OPCODE(6D, ABS, ADC, 4, 0)
+    OPCODE(6E, ABS, ROR, 6, 0)
+    OPCODE(6F, ABS, RRA, 6, 0)
+    OPCODE(70, REL, BVS, 2, 0)
+    OPCODE(71, IZY, ADC, 5, 1)
+    OPCODE(72, IMP, JAM, 2, 0)
+    OPCODE(73, IZY, RRA, 8, 0)
+    OPCODE(74, ZPX, NOP, 4, 0)
+    OPCODE(75, ZPX, ADC, 4, 0)
+    OPCODE(76, ZPX, ROR, 6, 0)
+    OPCODE(77, ZPX, RRA, 6, 0)
+    OPCODE(78, IMP, SEI, 2, 0)
+    OPCODE(79, ABY, ADC, 4, 1)
+    OPCODE(7A, IMP, NOP, 2, 0)
+    OPCODE(7B, ABY, RRA, 7, 0)
+    OPCODE(7C, ABX, NOP, 4, 1)
+    OPCODE(7D, ABX, ADC, 4, 1)
+    OPCODE(7E, ABX, ROR, 7, 0)
+    OPCODE(7F, ABX, RRA, 7, 0)
+    OPCODE(80, IMM, NOP, 2, 0)
+    OPCODE(81, IZX, STA, 6, 0)
+    OPCODE(82, IMM, NOP, 2, 0)
+    OPCODE(83, IZX, SAX, 6, 0)
+    OPCODE(84, ZP, STY, 3, 0)
+    OPCODE(85, ZP, STA, 3, 0)
+    OPCODE(86, ZP, STX, 3, 0)
+    OPCODE(87, ZP, SAX, 3, 0)
+    OPCODE(88, IMP, DEY, 2, 0)
+    OPCODE(89, IMM, NOP, 2, 0)
+    OPCODE(8A, IMP, TXA, 2, 0)
+    OPCODE(8B, IMM, XAA, 2, 0)
+    OPCODE(8C, ABS, STY, 4, 0)
+    OPCODE(8D, ABS, STA, 4, 0)
+    OPCODE(8E, ABS, STX, 4, 0)
+    OPCODE(8F, ABS, SAX, 4, 0)
+    OPCODE(90, REL, BCC, 2, 0)
+    OPCODE(91, IZY, STA, 6, 0)
+    OPCODE(92, IMP, JAM, 2, 0)
+    OPCODE(93, IZY, SHA, 6, 0)
+    OPCODE(94, ZPX, STY, 4, 0)
+    OPCODE(95, ZPX, STA, 4, 0)
+    OPCODE(96, ZPY, STX, 4, 0)
+    OPCODE(97, ZPY, SAX, 4, 0)
+    OPCODE(98, IMP, TYA, 2, 0)
+    OPCODE(99, ABY, STA, 5, 0)
+    OPCODE(9A, IMP, TXS, 2, 0)
+    OPCODE(9B, ABY, TAS, 5, 0)
+    OPCODE(9C, ABX, SHY, 5, 0)
+    OPCODE(9D, ABX, STA, 5, 0)
+    OPCODE(9E, ABY, SHX, 5, 0)
+    OPCODE(9F, ABY, SHA, 5, 0)
+    OPCODE(A0, IMM, LDY, 2, 0)
+    OPCODE(A1, IZX, LDA, 6, 0)
+    OPCODE(A2, IMM, LDX, 2, 0)
+    OPCODE(A3, IZX, LAX, 6, 0)
+    OPCODE(A4, ZP, LDY, 3, 0)
+    OPCODE(A5, ZP, LDA, 3, 0)
+    OPCODE(A6, ZP, LDX, 3, 0)
+    OPCODE(A7, ZP, LAX, 3, 0)
+    OPCODE(A8, IMP, TAY, 2, 0)
+    OPCODE(A9, IMM, LDA, 2, 0)
+    OPCODE(AA, IMP, TAX, 2, 0)
+    OPCODE(AB, IMM, LAX, 2, 0)
+    OPCODE(AC, ABS, LDY, 4, 0)
+    OPCODE(AD, ABS, LDA, 4, 0)
+    OPCODE(AE, ABS, LDX, 4, 0)
+    OPCODE(AF, ABS, LAX, 4, 0)
+    OPCODE(B0, REL, BCS, 2, 0)
+    OPCODE(B1, IZY, LDA, 5, 1)
+    OPCODE(B2, IMP, JAM, 2, 0)
+    OPCODE(B3, IZY, LAX, 5, 1)
+    OPCODE(B4, ZPX, LDY, 4, 0)
+    OPCODE(B5, ZPX, LDA, 4, 0)
+    OPCODE(B6, ZPY, LDX, 4, 0)
+    OPCODE(B7, ZPY, LAX, 4, 0)
+    OPCODE(B8, IMP, CLV, 2, 0)
+    OPCODE(B9, ABY, LDA, 4, 1)
+    OPCODE(BA, IMP, TSX, 2, 0)
+    OPCODE(BB, ABY, LAS, 4, 1)
+    OPCODE(BC, ABX, LDY, 4, 1)
+    OPCODE(BD, ABX, LDA, 4, 1)
+    OPCODE(BE, ABY, LDX, 4, 1)
+    OPCODE(BF, ABY, LAX, 4, 1)
+    OPCODE(C0, IMM, CPY, 2, 0)
+    OPCODE(C1, IZX, CMP, 6, 0)
+    OPCODE(C2, IMM, NOP, 2, 0)
+    OPCODE(C3, IZX, DCP, 8, 0)
+    OPCODE(C4, ZP, CPY, 3, 0)
+    OPCODE(C5, ZP, CMP, 3, 0)
+    OPCODE(C6, ZP, DEC, 5, 0)
+    OPCODE(C7, ZP, DCP, 5, 0)
+    OPCODE(C8, IMP, INY, 2, 0)
+    OPCODE(C9, IMM, CMP, 2, 0)
+    OPCODE(CA, IMP, DEX, 2, 0)
+    OPCODE(CB, IMM, SBX, 2, 0)
+    OPCODE(CC, ABS, CPY, 4, 0)
+    OPCODE(CD, ABS, CMP, 4, 0)
+    OPCODE(CE, ABS, DEC, 6, 0)
+    OPCODE(CF, ABS, DCP, 6, 0)
+    OPCODE(D0, REL, BNE, 2, 0)
+    OPCODE(D1, IZY, CMP, 5, 1)
+    OPCODE(D2, IMP, JAM, 2, 0)
+    OPCODE(D3, IZY, DCP, 8, 0)
+    OPCODE(D4, ZPX, NOP, 4, 0)
+    OPCODE(D5, ZPX, CMP, 4, 0)
+    OPCODE(D6, ZPX, DEC, 6, 0)
+    OPCODE(D7, ZPX, DCP, 6, 0)
+    OPCODE(D8, IMP, CLD, 2, 0)
+    OPCODE(D9, ABY, CMP, 4, 1)
+    OPCODE(DA, IMP, NOP, 2, 0)
+    OPCODE(DB, ABY, DCP, 7, 0)
+    OPCODE(DC, ABX, NOP, 4, 1)
+    OPCODE(DD, ABX, CMP, 4, 1)
+    OPCODE(DE, ABX, DEC, 7, 0)
+    OPCODE(DF, ABX, DCP, 7, 0)
+    OPCODE(E0, IMM, CPX, 2, 0)
+    OPCODE(E1, IZX, SBC, 6, 0)
+    OPCODE(E2, IMM, NOP, 2, 0)
+    OPCODE(E3, IZX, ISC, 8, 0)
+    OPCODE(E4, ZP, CPX, 3, 0)
+    OPCODE(E5, ZP, SBC, 3, 0)
+    OPCODE(E6, ZP, INC, 5, 0)
+    OPCODE(E7, ZP, ISC, 5, 0)
+    OPCODE(E8, IMP, INX, 2, 0)
+    OPCODE(E9, IMM, SBC, 2, 0)
+    OPCODE(EA, IMP, NOP, 2, 0)
+    OPCODE(EB, IMM, SBC, 2, 0)
+    OPCODE(EC, ABS, CPX, 4, 0)
+    OPCODE(ED, ABS, SBC, 4, 0)
+    OPCODE(EE, ABS, INC, 6, 0)
+    OPCODE(EF, ABS, ISC, 6, 0)
+    OPCODE(F0, REL, BEQ, 2, 0)
+    OPCODE(F1, IZY, SBC, 5, 1)
+    OPCODE(F2, IMP, JAM, 2, 0)
+    OPCODE(F3, IZY, ISC, 8, 0)
+    OPCODE(F4, ZPX, NOP, 4, 0)
+    OPCODE(F5, ZPX, SBC, 4, 0)
+    OPCODE(F6, ZPX, INC, 6, 0)
+    OPCODE(F7, ZPX, ISC, 6, 0)
+    OPCODE(F8, IMP, SED, 2, 0)
+    OPCODE(F9, ABY, SBC, 4, 1)
+    OPCODE(FA, IMP, NOP, 2, 0)
+    OPCODE(FB, ABY, ISC, 7, 0)
+    OPCODE(FC, ABX, NOP, 4, 1)
+    OPCODE(FD, ABX, SBC, 4, 1)
+    OPCODE(FE, ABX, INC, 7, 0)
+    OPCODE(FF, ABX, ISC, 7, 0)
+
+done:
+    nes->A = A;
+    nes->X = X;
+    nes->Y = Y;
+    nes->P = P;
+    nes->SP = SP;
+    nes->PC = PC;
+    nes->cycles += cycles;
+    return executed;
+}
+
+#endif
@@ -0,0 +1,118 @@
+// nes-headless - run a ROM without a display
+//
+// Links only the emulator core (bin/libnescore.a, no SDL), for batch runs on
+// servers: N frames as fast as the host allows, then optional dumps of the
+// final framebuffer and CPU RAM, and the timing.
+//
+// Usage: nes-headless <ROM file> [options]
+//   --frames N      frames to run (default 600)
+//   --accurate      accurate tier (dot-based PPU) instead of the fast one
+//   --blocks        enable the predecoded block cache
+//   --jit           enable the x86-64 JIT (binary built with JIT=1)
+//   --frame FILE    dump the last framebuffer (256x240 bytes, 6-bit NES colors)
+//   --ram FILE      dump the 2 KB of CPU RAM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../includes/nes.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int dump_file(const char *path, const void *data, size_t size) {
+    FILE *file = fopen(path, "wb");
+    if (!file || fwrite(data, 1, size, file) != size) {
+        fprintf(stderr, "❌ Cannot write %s\n", path);
+        if (file) fclose(file);
+        return 1;
+    }
+    fclose(file);
+    return 0;
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s <ROM file> [--frames N] [--accurate] [--blocks | --jit] [--frame FILE] [--ram FILE]\n", name);
+    printf("  --frames N    frames to run (default 600)\n");
+    printf("  --accurate    dot-based PPU for games with raster tricks\n");
+    printf("  --blocks      predecoded block cache\n");
+    printf("  --jit         x86-64 JIT (JIT=1 builds)\n");
+    printf("  --frame FILE  dump the last framebuffer (256x240 6-bit NES colors)\n");
+    printf("  --ram FILE    dump the CPU RAM (2 KB)\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *rom_path = argv[1];
+    const char *frame_path = NULL;
+    const char *ram_path = NULL;
+    int frames = 600;
+    bool accurate = false, blocks = false, jit = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc) frame_path = argv[++i];
+        else if (strcmp(argv[i], "--ram") == 0 && i + 1 < argc) ram_path = argv[++i];
+        else if (strcmp(argv[i], "--accurate") == 0) accurate = true;
+        else if (strcmp(argv[i], "--blocks") == 0) blocks = true;
+        else if (strcmp(argv[i], "--jit") == 0) jit = blocks = true;
+        else {
+            fprintf(stderr, "❌ Unknown option: %s\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // === Init CPU & PPU ===
+    NES *nes = nes_create();
+    if (!nes) {
+        fprintf(stderr, "❌ Out of memory\n");
+        return 1;
+    }
+    CPU *cpu = &nes->cpu;
+    PPU *ppu = &nes->ppu;
+
+    if (nes_load(nes, rom_path) != 0) {
+        fprintf(stderr, "❌ Failed to load ROM: %s\n", rom_path);
+        nes_destroy(nes);
+        return 1;
+    }
+    cpu_enable_block_cache(cpu, blocks);
+    if (jit && !cpu_enable_jit(cpu, true)) {
+        fprintf(stderr, "❌ JIT not available in this build (JIT=1, x86-64 only)\n");
+        nes_destroy(nes);
+        return 1;
+    }
+    nes_set_tier(cpu, accurate ? PPU_TIER_ACCURATE : PPU_TIER_FAST);
+
+    // === Run ===
+    double start = now_seconds();
+    for (int frame = 0; frame < frames; frame++) {
+        nes_run_frame(cpu);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("✅ %d frames (%s tier), %llu CPU cycles, PC: 0x%04X\n", frames, ppu->tier->name,
+           (unsigned long long)cpu->cycles, cpu->PC);
+    printf("⏱️ %.3f s, %.1f frames/s (%.1fx real time)\n", elapsed,
+           frames / elapsed, frames / elapsed / 60.0988);
+
+    // === Dumps ===
+    int status = 0;
+    if (frame_path) {
+        status |= dump_file(frame_path, ppu->framebuffer, sizeof(ppu->framebuffer));
+    }
+    if (ram_path) {
+        status |= dump_file(ram_path, cpu->ram, sizeof(cpu->ram));
+    }
+
+    nes_destroy(nes);
+    return status;
+}
@@ -0,0 +1,1117 @@
+/*
+=== JIT (x86-64) ===
+Translates hot predecoded blocks (see block_cache.h) into native code.
+
+Registers while a native block runs:
+    rbx = CPU*   rbp = P   r12 = A   r13 = X   r14 = Y   r15 = last N/Z result
+All of them hold zero-extended bytes. rax/rcx/rdx/rsi/rdi are scratch and get
+clobbered by calls into the bus helpers.
+
+Lazy flags: instructions that only set N/Z from a result copy it to r15 and mark
+N/Z as pending. The real N/Z bits of P are rebuilt only when something reads P
+(PHP, branches, block exit) or overwrites them wholesale (BIT, PLP).
+
+Memory: zero page, stack and static RAM addresses are direct loads/stores into
+CPU::ram. Indexed/indirect addresses test for $0000-$1FFF inline and otherwise
+call the bus like the interpreter does (PPU/APU registers, PRG, mappers).
+Absolute accesses to $2000-$401F end the native prefix so the interpreter runs
+them, and so does any indexed/indirect store that can reach $4014 (right after
+it): the OAM DMA stall must be seen by the budget check before going on. An NMI
+raised by the PPU sync inside such a store (or an RMW's dummy write) is only
+latched (cpu_nmi), so the registers held natively stay valid until the exit.
+Code outside read-only pages is never compiled (the block cache only builds
+blocks there), which keeps self-modifying RAM code interpreted.
+
+Cycles are added to CPU::cycles after each instruction, exactly like the
+reference core, so I/O handlers observe the same state.
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../includes/jit.h"
+#include "../includes/cpu.h"
+#include "../includes/block_cache.h"
+#include "../includes/opcodes.h"
+
+#if JIT_AVAILABLE
+
+#include <sys/mman.h>
+
+// === x86-64 encoding ===
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+#define R_CPU RBX
+#define R_P   RBP
+#define R_A   R12
+#define R_X   R13
+#define R_Y   R14
+#define R_NZ  R15
+
+// op r/m32, r32
+#define X_ADD  0x01
+#define X_OR   0x09
+#define X_AND  0x21
+#define X_SUB  0x29
+#define X_XOR  0x31
+#define X_CMP  0x39
+#define X_TEST 0x85
+#define X_MOV  0x89
+
+// Group 1 extensions for op r/m32, imm32
+#define G_ADD 0
+#define G_OR  1
+#define G_AND 4
+#define G_SUB 5
+#define G_XOR 6
+#define G_CMP 7
+
+// Condition codes
+#define CC_AE 0x3
+#define CC_E  0x4
+#define CC_NE 0x5
+
+#define OFF(field) ((int32_t)offsetof(CPU, field))
+#define OFF_STACK  (OFF(ram) + 0x0100)
+
+#define MAX_EXITS 4
+
+typedef struct {
+    uint8_t *start;
+    uint8_t *p;
+    uint8_t *end;
+    bool overflow;
+
+    bool lazy_nz;  // N/Z live in r15 instead of P
+
+    uint8_t *exits[MAX_EXITS];  // jmp rel32 to patch with the epilogue
+    int exit_count;
+} Emitter;
+
+static void emit8(Emitter *e, uint8_t b) {
+    if (e->p < e->end) *e->p++ = b;
+    else e->overflow = true;
+}
+
+static void emit16(Emitter *e, uint16_t v) {
+    emit8(e, v & 0xFF);
+    emit8(e, v >> 8);
+}
+
+static void emit32(Emitter *e, uint32_t v) {
+    for (int i = 0; i < 4; i++) emit8(e, (v >> (i * 8)) & 0xFF);
+}
+
+static void emit64(Emitter *e, uint64_t v) {
+    for (int i = 0; i < 8; i++) emit8(e, (v >> (i * 8)) & 0xFF);
+}
+
+// force: byte registers need a REX prefix so sil/dil/bpl are not read as dh/bh/ch
+static void emit_rex(Emitter *e, int w, int reg, int index, int base, bool force) {
+    uint8_t rex = 0x40 | (w << 3) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+    if (rex != 0x40 || force) emit8(e, rex);
+}
+
+// [base + index + disp32], index < 0 for none
+static void emit_mem(Emitter *e, int reg, int base, int index, int32_t disp) {
+    if (index >= 0) {
+        emit8(e, 0x84 | ((reg & 7) << 3));
+        emit8(e, ((index & 7) << 3) | (base & 7));
+    } else if ((base & 7) == RSP) {
+        emit8(e, 0x84 | ((reg & 7) << 3));
+        emit8(e, 0x24);
+    } else {
+        emit8(e, 0x80 | ((reg & 7) << 3) | (base & 7));
+    }
+    emit32(e, (uint32_t)disp);
+}
+
+static void emit_rr(Emitter *e, uint8_t opcode, int dst, int src) {
+    emit_rex(e, 0, src, 0, dst, false);
+    emit8(e, opcode);
+    emit8(e, 0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+static void emit_ri(Emitter *e, int ext, int dst, uint32_t imm) {
+    emit_rex(e, 0, 0, 0, dst, false);
+    emit8(e, 0x81);
+    emit8(e, 0xC0 | (ext << 3) | (dst & 7));
+    emit32(e, imm);
+}
+
+static void emit_mov_ri(Emitter *e, int dst, uint32_t imm) {
+    emit_rex(e, 0, 0, 0, dst, false);
+    emit8(e, 0xB8 + (dst & 7));
+    emit32(e, imm);
+}
+
+static void emit_shl(Emitter *e, int dst, uint8_t n) {
+    emit_rex(e, 0, 0, 0, dst, false);
+    emit8(e, 0xC1);
+    emit8(e, 0xE0 | (dst & 7));
+    emit8(e, n);
+}
+
+static void emit_shr(Emitter *e, int dst, uint8_t n) {
+    emit_rex(e, 0, 0, 0, dst, false);
+    emit8(e, 0xC1);
+    emit8(e, 0xE8 | (dst & 7));
+    emit8(e, n);
+}
+
+static void emit_test_ri(Emitter *e, int dst, uint32_t imm) {
+    emit_rex(e, 0, 0, 0, dst, false);
+    emit8(e, 0xF7);
+    emit8(e, 0xC0 | (dst & 7));
+    emit32(e, imm);
+}
+
+// movzx dst, byte [base + index + disp]
+static void emit_load8(Emitter *e, int dst, int base, int index, int32_t disp) {
+    emit_rex(e, 0, dst, index < 0 ? 0 : index, base, false);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit_mem(e, dst, base, index, disp);
+}
+
+// mov byte [base + index + disp], src8
+static void emit_store8(Emitter *e, int src, int base, int index, int32_t disp) {
+    emit_rex(e, 0, src, index < 0 ? 0 : index, base, true);
+    emit8(e, 0x88);
+    emit_mem(e, src, base, index, disp);
+}
+
+static void emit_store8_imm(Emitter *e, int base, int index, int32_t disp, uint8_t imm) {
+    emit_rex(e, 0, 0, index < 0 ? 0 : index, base, false);
+    emit8(e, 0xC6);
+    emit_mem(e, 0, base, index, disp);
+    emit8(e, imm);
+}
+
+static void emit_store16_imm(Emitter *e, int base, int32_t disp, uint16_t imm) {
+    emit8(e, 0x66);
+    emit_rex(e, 0, 0, 0, base, false);
+    emit8(e, 0xC7);
+    emit_mem(e, 0, base, -1, disp);
+    emit16(e, imm);
+}
+
+static void emit_store16(Emitter *e, int src, int base, int32_t disp) {
+    emit8(e, 0x66);
+    emit_rex(e, 0, src, 0, base, false);
+    emit8(e, 0x89);
+    emit_mem(e, src, base, -1, disp);
+}
+
+static void emit_load32(Emitter *e, int dst, int base, int32_t disp) {
+    emit_rex(e, 0, dst, 0, base, false);
+    emit8(e, 0x8B);
+    emit_mem(e, dst, base, -1, disp);
+}
+
+static void emit_store32(Emitter *e, int src, int base, int32_t disp) {
+    emit_rex(e, 0, src, 0, base, false);
+    emit8(e, 0x89);
+    emit_mem(e, src, base, -1, disp);
+}
+
+// add qword [base + disp], imm32
+static void emit_add64_mem_imm(Emitter *e, int base, int32_t disp, uint32_t imm) {
+    emit_rex(e, 1, 0, 0, base, false);
+    emit8(e, 0x81);
+    emit_mem(e, 0, base, -1, disp);
+    emit32(e, imm);
+}
+
+// add qword [base + disp], src
+static void emit_add64_mem_reg(Emitter *e, int base, int32_t disp, int src) {
+    emit_rex(e, 1, src, 0, base, false);
+    emit8(e, 0x01);
+    emit_mem(e, src, base, -1, disp);
+}
+
+static void emit_movzx8(Emitter *e, int dst, int src) {
+    emit_rex(e, 0, dst, 0, src, true);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit8(e, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+static void emit_setcc(Emitter *e, int cc, int dst) {
+    emit_rex(e, 0, 0, 0, dst, true);
+    emit8(e, 0x0F);
+    emit8(e, 0x90 + cc);
+    emit8(e, 0xC0 | (dst & 7));
+}
+
+static uint8_t *emit_jcc(Emitter *e, int cc) {
+    emit8(e, 0x0F);
+    emit8(e, 0x80 + cc);
+    uint8_t *rel = e->p;
+    emit32(e, 0);
+    return rel;
+}
+
+static uint8_t *emit_jmp(Emitter *e) {
+    emit8(e, 0xE9);
+    uint8_t *rel = e->p;
+    emit32(e, 0);
+    return rel;
+}
+
+// Point a rel32 at the current position
+static void patch_here(Emitter *e, uint8_t *rel) {
+    if (e->overflow) return;
+    int32_t delta = (int32_t)(e->p - (rel + 4));
+    memcpy(rel, &delta, sizeof(delta));
+}
+
+static void emit_push(Emitter *e, int reg) {
+    emit_rex(e, 0, 0, 0, reg, false);
+    emit8(e, 0x50 + (reg & 7));
+}
+
+static void emit_pop(Emitter *e, int reg) {
+    emit_rex(e, 0, 0, 0, reg, false);
+    emit8(e, 0x58 + (reg & 7));
+}
+
+static void emit_call(Emitter *e, const void *fn) {
+    // mov rdi, rbx ; mov rax, imm64 ; call rax
+    emit_rex(e, 1, R_CPU, 0, RDI, false);
+    emit8(e, 0x89);
+    emit8(e, 0xC0 | ((R_CPU & 7) << 3) | (RDI & 7));
+    emit8(e, 0x48);
+    emit8(e, 0xB8);
+    emit64(e, (uint64_t)(uintptr_t)fn);
+    emit8(e, 0xFF);
+    emit8(e, 0xD0);
+}
+
+// === Bus helpers called from native code ===
+
+static uint8_t jit_read(CPU *nes, uint32_t addr) {
+    return cpu_bus_read(nes, addr);
+}
+
+static void jit_write(CPU *nes, uint32_t addr, uint32_t value) {
+    cpu_bus_write(nes, addr, value);
+}
+
+// Same as the slow path of cpu_rmw_begin: non-RAM pages get the dummy write
+static uint8_t jit_rmw_begin(CPU *nes, uint32_t addr) {
+    uint8_t *page = nes->write_map[addr >> CPU_PAGE_SHIFT];
+    uint8_t value = cpu_bus_read(nes, addr);
+    if (!page || page != nes->read_map[addr >> CPU_PAGE_SHIFT]) {
+        cpu_bus_write(nes, addr, value);
+    }
+    return value;
+}
+
+// === Flags ===
+
+static void nz_from(Emitter *e, int reg) {
+    emit_rr(e, X_MOV, R_NZ, reg);
+    e->lazy_nz = true;
+}
+
+// Fold the pending N/Z result back into P
+static void materialize_nz(Emitter *e) {
+    if (!e->lazy_nz) return;
+
+    emit_ri(e, G_AND, R_P, (uint8_t)~(FLAG_N | FLAG_Z));
+    emit_rr(e, X_MOV, RAX, R_NZ);
+    emit_ri(e, G_AND, RAX, FLAG_N);
+    emit_rr(e, X_OR, R_P, RAX);
+    emit_rr(e, X_TEST, R_NZ, R_NZ);
+    emit_setcc(e, CC_E, RAX);
+    emit_movzx8(e, RAX, RAX);
+    emit_shl(e, RAX, 1);  // FLAG_Z
+    emit_rr(e, X_OR, R_P, RAX);
+    e->lazy_nz = false;
+}
+
+// C = reg, which must hold 0 or 1
+static void set_carry_from(Emitter *e, int reg) {
+    emit_ri(e, G_AND, R_P, (uint8_t)~FLAG_C);
+    emit_rr(e, X_OR, R_P, reg);
+}
+
+// === Exits ===
+
+static void emit_exit(Emitter *e) {
+    if (e->exit_count < MAX_EXITS) {
+        e->exits[e->exit_count++] = emit_jmp(e);
+    } else {
+        e->overflow = true;
+    }
+}
+
+static void emit_exit_to(Emitter *e, uint16_t pc) {
+    materialize_nz(e);
+    emit_store16_imm(e, R_CPU, OFF(PC), pc);
+    emit_exit(e);
+}
+
+static void emit_cycles(Emitter *e, int cycles) {
+    emit_add64_mem_imm(e, R_CPU, OFF(cycles), cycles);
+}
+
+// === Operands ===
+
+typedef enum {
+    LOC_IMM,       // Constant
+    LOC_RAM,       // Static RAM offset
+    LOC_ZP_INDEX,  // Zero page address in esi
+    LOC_BUS        // 16-bit address in esi
+} LocKind;
+
+typedef struct {
+    LocKind kind;
+    uint16_t addr;
+    uint8_t imm;
+    bool may_be_ram;  // LOC_BUS: test for $0000-$1FFF inline
+} Loc;
+
+// Resolve the effective address. Returns false for static I/O addresses.
+static bool emit_address(Emitter *e, CPU *nes, const DecodedInsn *insn, Loc *loc) {
+    memset(loc, 0, sizeof(*loc));
+
+    switch (insn->mode) {
+        case AM_IMM:
+            // Operand comes from the block's own ROM page, which cannot change
+            // without invalidating the block
+            loc->kind = LOC_IMM;
+            loc->imm = nes->read_map[insn->operand >> CPU_PAGE_SHIFT][insn->operand & 0xFF];
+            return true;
+
+        case AM_ZP:
+            loc->kind = LOC_RAM;
+            loc->addr = insn->operand;
+            return true;
+
+        case AM_ABS:
+            if (insn->operand < 0x2000) {
+                loc->kind = LOC_RAM;
+                loc->addr = insn->operand & 0x07FF;
+                return true;
+            }
+            if (insn->operand < 0x4020) {
+                return false;
+            }
+            loc->kind = LOC_BUS;
+            emit_mov_ri(e, RSI, insn->operand);
+            return true;
+
+        case AM_ZPX:
+        case AM_ZPY:
+            emit_rr(e, X_MOV, RSI, insn->mode == AM_ZPX ? R_X : R_Y);
+            emit_ri(e, G_ADD, RSI, insn->operand);
+            emit_ri(e, G_AND, RSI, 0xFF);
+            loc->kind = LOC_ZP_INDEX;
+            return true;
+
+        case AM_ABX:
+        case AM_ABY:
+            emit_rr(e, X_MOV, RSI, insn->mode == AM_ABX ? R_X : R_Y);
+            emit_ri(e, G_ADD, RSI, insn->operand);
+            emit_ri(e, G_AND, RSI, 0xFFFF);
+            loc->kind = LOC_BUS;
+            loc->may_be_ram = true;
+            return true;
+
+        case AM_IZX:
+            emit_rr(e, X_MOV, RAX, R_X);
+            emit_ri(e, G_ADD, RAX, insn->operand);
+            emit_ri(e, G_AND, RAX, 0xFF);
+            emit_load8(e, RSI, R_CPU, RAX, OFF(ram));
+            emit_ri(e, G_ADD, RAX, 1);
+            emit_ri(e, G_AND, RAX, 0xFF);
+            emit_load8(e, RCX, R_CPU, RAX, OFF(ram));
+            emit_shl(e, RCX, 8);
+            emit_rr(e, X_OR, RSI, RCX);
+            loc->kind = LOC_BUS;
+            loc->may_be_ram = true;
+            return true;
+
+        case AM_IZY:
+            emit_load8(e, RSI, R_CPU, -1, OFF(ram) + insn->operand);
+            emit_load8(e, RCX, R_CPU, -1, OFF(ram) + ((insn->operand + 1) & 0xFF));
+            emit_shl(e, RCX, 8);
+            emit_rr(e, X_OR, RSI, RCX);
+            emit_rr(e, X_ADD, RSI, R_Y);
+            emit_ri(e, G_AND, RSI, 0xFFFF);
+            loc->kind = LOC_BUS;
+            loc->may_be_ram = true;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// Page-cross penalty, recomputed after the access (index registers are unchanged
+// by every instruction that has a penalty)
+static void emit_penalty(Emitter *e, const DecodedInsn *insn) {
+    switch (insn->mode) {
+        case AM_ABX:
+        case AM_ABY:
+            emit_rr(e, X_MOV, RAX, insn->mode == AM_ABX ? R_X : R_Y);
+            emit_ri(e, G_ADD, RAX, insn->operand & 0xFF);
+            break;
+
+        case AM_IZY:
+            emit_load8(e, RAX, R_CPU, -1, OFF(ram) + insn->operand);
+            emit_rr(e, X_ADD, RAX, R_Y);
+            break;
+
+        default:
+            return;
+    }
+    emit_shr(e, RAX, 8);
+    emit_add64_mem_reg(e, R_CPU, OFF(cycles), RAX);
+}
+
+// Value -> ecx
+static void emit_load(Emitter *e, const Loc *loc) {
+    switch (loc->kind) {
+        case LOC_IMM:
+            emit_mov_ri(e, RCX, loc->imm);
+            break;
+
+        case LOC_RAM:
+            emit_load8(e, RCX, R_CPU, -1, OFF(ram) + loc->addr);
+            break;
+
+        case LOC_ZP_INDEX:
+            emit_load8(e, RCX, R_CPU, RSI, OFF(ram));
+            break;
+
+        case LOC_BUS: {
+            uint8_t *slow = NULL, *done = NULL;
+            if (loc->may_be_ram) {
+                emit_ri(e, G_CMP, RSI, 0x2000);
+                slow = emit_jcc(e, CC_AE);
+                emit_rr(e, X_MOV, RAX, RSI);
+                emit_ri(e, G_AND, RAX, 0x07FF);
+                emit_load8(e, RCX, R_CPU, RAX, OFF(ram));
+                done = emit_jmp(e);
+                patch_here(e, slow);
+            }
+            emit_call(e, (const void *)jit_read);
+            emit_movzx8(e, RCX, RAX);
+            if (done) patch_here(e, done);
+            break;
+        }
+    }
+}
+
+static void emit_store(Emitter *e, const Loc *loc, int src) {
+    switch (loc->kind) {
+        case LOC_IMM:
+            break;
+
+        case LOC_RAM:
+            emit_store8(e, src, R_CPU, -1, OFF(ram) + loc->addr);
+            break;
+
+        case LOC_ZP_INDEX:
+            emit_store8(e, src, R_CPU, RSI, OFF(ram));
+            break;
+
+        case LOC_BUS: {
+            uint8_t *slow = NULL, *done = NULL;
+            if (loc->may_be_ram) {
+                emit_ri(e, G_CMP, RSI, 0x2000);
+                slow = emit_jcc(e, CC_AE);
+                emit_rr(e, X_MOV, RAX, RSI);
+                emit_ri(e, G_AND, RAX, 0x07FF);
+                emit_store8(e, src, R_CPU, RAX, OFF(ram));
+                done = emit_jmp(e);
+                patch_here(e, slow);
+            }
+            emit_rr(e, X_MOV, RDX, src);
+            emit_call(e, (const void *)jit_write);
+            if (done) patch_here(e, done);
+            break;
+        }
+    }
+}
+
+// === Operations ===
+
+typedef void (*RmwEmitter)(Emitter *e);  // eax in, eax out, may clobber ecx/edx
+
+static void rmw_asl(Emitter *e) {
+    emit_rr(e, X_MOV, RDX, RAX);
+    emit_shr(e, RDX, 7);
+    set_carry_from(e, RDX);
+    emit_rr(e, X_ADD, RAX, RAX);
+    emit_ri(e, G_AND, RAX, 0xFF);
+    nz_from(e, RAX);
+}
+
+static void rmw_lsr(Emitter *e) {
+    emit_rr(e, X_MOV, RDX, RAX);
+    emit_ri(e, G_AND, RDX, 0x01);
+    set_carry_from(e, RDX);
+    emit_shr(e, RAX, 1);
+    nz_from(e, RAX);
+}
+
+static void rmw_rol(Emitter *e) {
+    emit_rr(e, X_MOV, RDX, R_P);
+    emit_ri(e, G_AND, RDX, FLAG_C);
+    emit_rr(e, X_MOV, RCX, RAX);
+    emit_shr(e, RCX, 7);
+    set_carry_from(e, RCX);
+    emit_rr(e, X_ADD, RAX, RAX);
+    emit_rr(e, X_OR, RAX, RDX);
+    emit_ri(e, G_AND, RAX, 0xFF);
+    nz_from(e, RAX);
+}
+
+static void rmw_ror(Emitter *e) {
+    emit_rr(e, X_MOV, RDX, R_P);
+    emit_ri(e, G_AND, RDX, FLAG_C);
+    emit_shl(e, RDX, 7);
+    emit_rr(e, X_MOV, RCX, RAX);
+    emit_ri(e, G_AND, RCX, 0x01);
+    set_carry_from(e, RCX);
+    emit_shr(e, RAX, 1);
+    emit_rr(e, X_OR, RAX, RDX);
+    nz_from(e, RAX);
+}
+
+static void rmw_inc(Emitter *e) {
+    emit_ri(e, G_ADD, RAX, 1);
+    emit_ri(e, G_AND, RAX, 0xFF);
+    nz_from(e, RAX);
+}
+
+static void rmw_dec(Emitter *e) {
+    emit_ri(e, G_SUB, RAX, 1);
+    emit_ri(e, G_AND, RAX, 0xFF);
+    nz_from(e, RAX);
+}
+
+static void emit_rmw(Emitter *e, const Loc *loc, RmwEmitter op) {
+    switch (loc->kind) {
+        case LOC_RAM:
+            emit_load8(e, RAX, R_CPU, -1, OFF(ram) + loc->addr);
+            op(e);
+            emit_store8(e, RAX, R_CPU, -1, OFF(ram) + loc->addr);
+            break;
+
+        case LOC_ZP_INDEX:
+            emit_load8(e, RAX, R_CPU, RSI, OFF(ram));
+            op(e);
+            emit_store8(e, RAX, R_CPU, RSI, OFF(ram));
+            break;
+
+        case LOC_BUS:
+            emit_store32(e, RSI, RSP, 0);
+            emit_call(e, (const void *)jit_rmw_begin);
+            emit_movzx8(e, RAX, RAX);
+            op(e);
+            emit_rr(e, X_MOV, RDX, RAX);
+            emit_load32(e, RSI, RSP, 0);
+            emit_call(e, (const void *)jit_write);
+            break;
+
+        case LOC_IMM:
+            break;
+    }
+}
+
+// A + ecx + C
+static void emit_adc(Emitter *e) {
+    emit_rr(e, X_MOV, RAX, R_P);
+    emit_ri(e, G_AND, RAX, FLAG_C);
+    emit_rr(e, X_ADD, RAX, R_A);
+    emit_rr(e, X_ADD, RAX, RCX);             // eax = sum (9 bits)
+    emit_rr(e, X_MOV, RDX, R_A);
+    emit_rr(e, X_XOR, RDX, RAX);             // A ^ sum
+    emit_rr(e, X_MOV, RSI, RCX);
+    emit_rr(e, X_XOR, RSI, RAX);             // value ^ sum
+    emit_rr(e, X_AND, RDX, RSI);
+    emit_ri(e, G_AND, RDX, 0x80);
+    emit_shr(e, RDX, 1);                     // FLAG_V
+    emit_ri(e, G_AND, R_P, (uint8_t)~(FLAG_C | FLAG_V));
+    emit_rr(e, X_OR, R_P, RDX);
+    emit_rr(e, X_MOV, RDX, RAX);
+    emit_shr(e, RDX, 8);                     // FLAG_C
+    emit_rr(e, X_OR, R_P, RDX);
+    emit_movzx8(e, R_A, RAX);
+    nz_from(e, R_A);
+}
+
+static void emit_compare(Emitter *e, int reg) {
+    emit_rr(e, X_CMP, reg, RCX);
+    emit_setcc(e, CC_AE, RDX);
+    emit_movzx8(e, RDX, RDX);
+    set_carry_from(e, RDX);
+    emit_rr(e, X_MOV, R_NZ, reg);
+    emit_rr(e, X_SUB, R_NZ, RCX);
+    emit_ri(e, G_AND, R_NZ, 0xFF);
+    e->lazy_nz = true;
+}
+
+// SP in eax, ram[0x100 + SP] addressing
+static void emit_push_imm(Emitter *e, uint8_t value) {
+    emit_store8_imm(e, R_CPU, RAX, OFF_STACK, value);
+    emit_ri(e, G_SUB, RAX, 1);
+    emit_ri(e, G_AND, RAX, 0xFF);
+}
+
+static void emit_push_reg(Emitter *e, int src) {
+    emit_store8(e, src, R_CPU, RAX, OFF_STACK);
+    emit_ri(e, G_SUB, RAX, 1);
+    emit_ri(e, G_AND, RAX, 0xFF);
+}
+
+static void emit_pull(Emitter *e, int dst) {
+    emit_ri(e, G_ADD, RAX, 1);
+    emit_ri(e, G_AND, RAX, 0xFF);
+    emit_load8(e, dst, R_CPU, RAX, OFF_STACK);
+}
+
+static void emit_load_sp(Emitter *e) {
+    emit_load8(e, RAX, R_CPU, -1, OFF(SP));
+}
+
+static void emit_store_sp(Emitter *e) {
+    emit_store8(e, RAX, R_CPU, -1, OFF(SP));
+}
+
+static bool is_branch(uint8_t op) {
+    switch (op) {
+        case OP_BPL: case OP_BMI: case OP_BVC: case OP_BVS:
+        case OP_BCC: case OP_BCS: case OP_BNE: case OP_BEQ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void emit_branch(Emitter *e, const DecodedInsn *insn, uint8_t opcode) {
+    static const uint8_t branch_flags[4] = { FLAG_N, FLAG_V, FLAG_C, FLAG_Z };
+    uint8_t flag = branch_flags[opcode >> 6];
+    bool expect_set = (opcode & 0x20) != 0;
+    uint16_t target = insn->operand;
+    int extra = ((insn->next_pc ^ target) & 0xFF00) ? 2 : 1;
+
+    emit_cycles(e, opcode_table[opcode].cycles);
+    materialize_nz(e);
+    emit_test_ri(e, R_P, flag);
+    uint8_t *taken = emit_jcc(e, expect_set ? CC_NE : CC_E);
+
+    emit_exit_to(e, insn->next_pc);
+
+    patch_here(e, taken);
+    emit_cycles(e, extra);
+    emit_exit_to(e, target);
+}
+
+// Returns false (nothing emitted that matters) if the instruction must be interpreted.
+// *exited is set when the instruction left the block.
+static bool emit_instruction(Emitter *e, CPU *nes, const DecodedInsn *insn, bool *exited) {
+    const Opcode *op = &opcode_table[insn->opcode];
+    Loc loc;
+
+    *exited = false;
+
+    if (is_branch(op->op)) {
+        emit_branch(e, insn, insn->opcode);
+        *exited = true;
+        return true;
+    }
+
+    switch (op->op) {
+        // --- Loads / ALU: value in ecx ---
+        case OP_LDA: case OP_LDX: case OP_LDY:
+        case OP_AND: case OP_ORA: case OP_EOR:
+        case OP_ADC: case OP_SBC:
+        case OP_CMP: case OP_CPX: case OP_CPY:
+        case OP_BIT:
+            if (!emit_address(e, nes, insn, &loc)) return false;
+            emit_load(e, &loc);
+
+            switch (op->op) {
+                case OP_LDA: emit_rr(e, X_MOV, R_A, RCX); nz_from(e, R_A); break;
+                case OP_LDX: emit_rr(e, X_MOV, R_X, RCX); nz_from(e, R_X); break;
+                case OP_LDY: emit_rr(e, X_MOV, R_Y, RCX); nz_from(e, R_Y); break;
+                case OP_AND: emit_rr(e, X_AND, R_A, RCX); nz_from(e, R_A); break;
+                case OP_ORA: emit_rr(e, X_OR, R_A, RCX); nz_from(e, R_A); break;
+                case OP_EOR: emit_rr(e, X_XOR, R_A, RCX); nz_from(e, R_A); break;
+                case OP_ADC: emit_adc(e); break;
+                case OP_SBC: emit_ri(e, G_XOR, RCX, 0xFF); emit_adc(e); break;
+                case OP_CMP: emit_compare(e, R_A); break;
+                case OP_CPX: emit_compare(e, R_X); break;
+                case OP_CPY: emit_compare(e, R_Y); break;
+
+                case OP_BIT:
+                    // N, V and Z are all overwritten: a pending N/Z is dropped
+                    e->lazy_nz = false;
+                    emit_ri(e, G_AND, R_P, (uint8_t)~(FLAG_N | FLAG_V | FLAG_Z));
+                    emit_rr(e, X_MOV, RAX, RCX);
+                    emit_ri(e, G_AND, RAX, FLAG_N | FLAG_V);
+                    emit_rr(e, X_OR, R_P, RAX);
+                    emit_rr(e, X_TEST, R_A, RCX);
+                    emit_setcc(e, CC_E, RAX);
+                    emit_movzx8(e, RAX, RAX);
+                    emit_shl(e, RAX, 1);
+                    emit_rr(e, X_OR, R_P, RAX);
+                    break;
+            }
+            emit_cycles(e, op->cycles);
+            if (op->page_penalty) emit_penalty(e, insn);
+            return true;
+
+        // --- Stores ---
+        case OP_STA: case OP_STX: case OP_STY:
+            if (!emit_address(e, nes, insn, &loc)) return false;
+            emit_store(e, &loc, op->op == OP_STA ? R_A : op->op == OP_STX ? R_X : R_Y);
+            emit_cycles(e, op->cycles);
+            return true;
+
+        // --- Read-modify-write ---
+        case OP_INC: case OP_DEC:
+        case OP_ASL: case OP_LSR: case OP_ROL: case OP_ROR: {
+            RmwEmitter rmw = op->op == OP_INC ? rmw_inc : op->op == OP_DEC ? rmw_dec :
+                             op->op == OP_ASL ? rmw_asl : op->op == OP_LSR ? rmw_lsr :
+                             op->op == OP_ROL ? rmw_rol : rmw_ror;
+            if (op->mode == AM_ACC) {
+                emit_rr(e, X_MOV, RAX, R_A);
+                rmw(e);
+                emit_rr(e, X_MOV, R_A, RAX);
+            } else {
+                if (!emit_address(e, nes, insn, &loc)) return false;
+                emit_rmw(e, &loc, rmw);
+            }
+            emit_cycles(e, op->cycles);
+            return true;
+        }
+
+        // --- Registers ---
+        case OP_TAX: emit_rr(e, X_MOV, R_X, R_A); nz_from(e, R_X); break;
+        case OP_TAY: emit_rr(e, X_MOV, R_Y, R_A); nz_from(e, R_Y); break;
+        case OP_TXA: emit_rr(e, X_MOV, R_A, R_X); nz_from(e, R_A); break;
+        case OP_TYA: emit_rr(e, X_MOV, R_A, R_Y); nz_from(e, R_A); break;
+        case OP_TSX: emit_load8(e, R_X, R_CPU, -1, OFF(SP)); nz_from(e, R_X); break;
+        case OP_TXS: emit_store8(e, R_X, R_CPU, -1, OFF(SP)); break;
+
+        case OP_INX: emit_ri(e, G_ADD, R_X, 1); emit_ri(e, G_AND, R_X, 0xFF); nz_from(e, R_X); break;
+        case OP_INY: emit_ri(e, G_ADD, R_Y, 1); emit_ri(e, G_AND, R_Y, 0xFF); nz_from(e, R_Y); break;
+        case OP_DEX: emit_ri(e, G_SUB, R_X, 1); emit_ri(e, G_AND, R_X, 0xFF); nz_from(e, R_X); break;
+        case OP_DEY: emit_ri(e, G_SUB, R_Y, 1); emit_ri(e, G_AND, R_Y, 0xFF); nz_from(e, R_Y); break;
+
+        // --- Flags ---
+        case OP_CLC: emit_ri(e, G_AND, R_P, (uint8_t)~FLAG_C); break;
+        case OP_CLD: emit_ri(e, G_AND, R_P, (uint8_t)~FLAG_D); break;
+        case OP_CLI: emit_ri(e, G_AND, R_P, (uint8_t)~FLAG_I); break;
+        case OP_CLV: emit_ri(e, G_AND, R_P, (uint8_t)~FLAG_V); break;
+        case OP_SEC: emit_ri(e, G_OR, R_P, FLAG_C); break;
+        case OP_SED: emit_ri(e, G_OR, R_P, FLAG_D); break;
+        case OP_SEI: emit_ri(e, G_OR, R_P, FLAG_I); break;
+
+        // The reference core does no bus access for NOPs, only the penalty
+        case OP_NOP:
+            emit_cycles(e, op->cycles);
+            if (op->page_penalty) emit_penalty(e, insn);
+            return true;
+
+        // --- Stack ---
+        case OP_PHA:
+            emit_load_sp(e);
+            emit_push_reg(e, R_A);
+            emit_store_sp(e);
+            break;
+
+        case OP_PHP:
+            materialize_nz(e);
+            emit_rr(e, X_MOV, RCX, R_P);
+            emit_ri(e, G_OR, RCX, FLAG_B | FLAG_U);
+            emit_load_sp(e);
+            emit_push_reg(e, RCX);
+            emit_store_sp(e);
+            break;
+
+        case OP_PLA:
+            emit_load_sp(e);
+            emit_pull(e, R_A);
+            emit_store_sp(e);
+            nz_from(e, R_A);
+            break;
+
+        case OP_PLP:
+            emit_load_sp(e);
+            emit_pull(e, R_P);
+            emit_store_sp(e);
+            emit_ri(e, G_AND, R_P, (uint8_t)~FLAG_B);
+            emit_ri(e, G_OR, R_P, FLAG_U);
+            e->lazy_nz = false;
+            break;
+
+        // --- Control flow ---
+        case OP_JMP:
+            if (op->mode != AM_ABS) return false;
+            emit_cycles(e, op->cycles);
+            emit_exit_to(e, insn->operand);
+            *exited = true;
+            return true;
+
+        case OP_JSR: {
+            uint16_t return_addr = insn->next_pc - 1;
+            emit_load_sp(e);
+            emit_push_imm(e, return_addr >> 8);
+            emit_push_imm(e, return_addr & 0xFF);
+            emit_store_sp(e);
+            emit_cycles(e, op->cycles);
+            emit_exit_to(e, insn->operand);
+            *exited = true;
+            return true;
+        }
+
+        case OP_RTS:
+            emit_load_sp(e);
+            emit_pull(e, RCX);
+            emit_pull(e, RDX);
+            emit_store_sp(e);
+            emit_shl(e, RDX, 8);
+            emit_rr(e, X_OR, RCX, RDX);
+            emit_ri(e, G_ADD, RCX, 1);
+            emit_store16(e, RCX, R_CPU, OFF(PC));
+            emit_cycles(e, op->cycles);
+            materialize_nz(e);
+            emit_exit(e);
+            *exited = true;
+            return true;
+
+        default:
+            // RTI, BRK, JMP (ind), illegal opcodes: interpreter
+            return false;
+    }
+
+    emit_cycles(e, op->cycles);
+    return true;
+}
+
+// === Compiler ===
+
+// Bus store whose address can be $4014: the OAM DMA adds 513+ cycles that the
+// native guard does not account for, so the native prefix stops after it. The
+// stall can carry the PPU past vblank; the NMI waits in nmi_pending until the
+// interpreter loop takes it.
+static bool jit_may_start_dma(const DecodedInsn *insn) {
+    switch (opcode_table[insn->opcode].op) {
+        case OP_STA: case OP_STX: case OP_STY:
+        case OP_INC: case OP_DEC:
+        case OP_ASL: case OP_LSR: case OP_ROL: case OP_ROR:
+            break;
+        default:
+            return false;
+    }
+
+    switch (insn->mode) {
+        case AM_ABX:
+        case AM_ABY:
+            return (uint16_t)(0x4014 - insn->operand) <= 0xFF;
+        case AM_IZX:
+        case AM_IZY:
+            return true;
+        default:
+            return false;  // Absolute I/O is never native, see emit_address
+    }
+}
+
+static void emit_prologue(Emitter *e) {
+    emit_push(e, RBX);
+    emit_push(e, RBP);
+    emit_push(e, R12);
+    emit_push(e, R13);
+    emit_push(e, R14);
+    emit_push(e, R15);
+    // sub rsp, 8: keeps calls 16-byte aligned and gives a scratch slot at [rsp]
+    emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xEC); emit8(e, 0x08);
+
+    // mov rbx, rdi
+    emit_rex(e, 1, RDI, 0, RBX, false);
+    emit8(e, 0x89);
+    emit8(e, 0xC0 | ((RDI & 7) << 3) | (RBX & 7));
+
+    emit_load8(e, R_A, R_CPU, -1, OFF(A));
+    emit_load8(e, R_X, R_CPU, -1, OFF(X));
+    emit_load8(e, R_Y, R_CPU, -1, OFF(Y));
+    emit_load8(e, R_P, R_CPU, -1, OFF(P));
+    e->lazy_nz = false;
+}
+
+static void emit_epilogue(Emitter *e) {
+    for (int i = 0; i < e->exit_count; i++) {
+        patch_here(e, e->exits[i]);
+    }
+
+    emit_store8(e, R_A, R_CPU, -1, OFF(A));
+    emit_store8(e, R_X, R_CPU, -1, OFF(X));
+    emit_store8(e, R_Y, R_CPU, -1, OFF(Y));
+    emit_store8(e, R_P, R_CPU, -1, OFF(P));
+
+    emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xC4); emit8(e, 0x08);  // add rsp, 8
+    emit_pop(e, R15);
+    emit_pop(e, R14);
+    emit_pop(e, R13);
+    emit_pop(e, R12);
+    emit_pop(e, RBP);
+    emit_pop(e, RBX);
+    emit8(e, 0xC3);
+}
+
+// Native code bakes in "$0000-$1FFF is plain RAM"
+static bool jit_ram_is_direct(CPU *nes) {
+    for (int page = 0; page < 0x20; page++) {
+        uint8_t *ram_page = nes->ram + ((page & 0x07) << CPU_PAGE_SHIFT);
+        if (nes->read_map[page] != ram_page || nes->write_map[page] != ram_page) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool jit_compile(Jit *jit, CPU *nes, Block *block) {
+    if (!jit_ram_is_direct(nes)) {
+        return false;
+    }
+
+    Emitter e = {0};
+    e.start = e.p = jit->code + jit->used;
+    e.end = jit->code + JIT_CODE_SIZE;
+
+    emit_prologue(&e);
+
+    int count = 0;
+    bool exited = false;
+    for (int i = 0; i < block->count; i++) {
+        uint8_t *mark = e.p;
+        bool lazy = e.lazy_nz;
+        int exits = e.exit_count;
+
+        if (!emit_instruction(&e, nes, &block->insn[i], &exited)) {
+            e.p = mark;
+            e.lazy_nz = lazy;
+            e.exit_count = exits;
+            break;
+        }
+        count++;
+        if (exited || jit_may_start_dma(&block->insn[i])) break;
+    }
+
+    if (count == 0) {
+        return false;
+    }
+    if (!exited) {
+        emit_exit_to(&e, block->insn[count - 1].next_pc);
+    }
+    emit_epilogue(&e);
+
+    if (e.overflow) {
+        return false;
+    }
+
+    // Worst case cycles of everything before the last native instruction: if
+    // that still ends before the budget, the interpreter would not have stopped
+    // inside the prefix either
+    uint16_t guard = 0;
+    for (int i = 0; i < count - 1; i++) {
+        const Opcode *op = &opcode_table[block->insn[i].opcode];
+        guard += op->cycles + op->page_penalty;
+    }
+
+    block->native = e.start;
+    block->native_count = count;
+    block->native_guard = guard;
+
+    jit->used = (jit->used + (e.p - e.start) + 15) & ~(size_t)15;
+    jit->compiled++;
+    return true;
+}
+
+// === API ===
+
+Jit *jit_create(void) {
+    Jit *jit = calloc(1, sizeof(Jit));
+    if (!jit) return NULL;
+
+    jit->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) {
+        free(jit);
+        return NULL;
+    }
+    return jit;
+}
+
+void jit_destroy(Jit *jit) {
+    if (!jit) return;
+    munmap(jit->code, JIT_CODE_SIZE);
+    free(jit);
+}
+
+void jit_flush(Jit *jit, CPU *nes) {
+    jit->used = 0;
+    jit->flushes++;
+
+    if (!nes->block_cache) return;
+    for (int i = 0; i < BLOCK_CACHE_SIZE; i++) {
+        Block *block = &nes->block_cache->blocks[i];
+        block->native = NULL;
+        block->native_count = 0;
+        block->native_state = JIT_NONE;
+        block->heat = 0;
+    }
+}
+
+int jit_run_block(Jit *jit, CPU *nes, Block *block, uint64_t end) {
+    if (block->native_state == JIT_NONE) {
+        if (++block->heat < JIT_HOT_THRESHOLD) {
+            return 0;
+        }
+        bool ok = jit_compile(jit, nes, block);
+        if (!ok && jit->used > JIT_CODE_SIZE / 2) {
+            // Probably out of space: start over and retry once
+            jit_flush(jit, nes);
+            ok = jit_compile(jit, nes, block);
+        }
+        block->native_state = ok ? JIT_NATIVE : JIT_REJECTED;
+    }
+
+    if (block->native_state != JIT_NATIVE || nes->cycles + block->native_guard >= end) {
+        return 0;
+    }
+
+    ((void (*)(CPU *))block->native)(nes);
+    jit->native_runs++;
+    return block->native_count;
+}
+
+#else
+
+Jit *jit_create(void) {
+    return NULL;
+}
+
+void jit_destroy(Jit *jit) {
+    (void)jit;
+}
+
+void jit_flush(Jit *jit, CPU *nes) {
+    (void)jit; (void)nes;
+}
+
+int jit_run_block(Jit *jit, CPU *nes, Block *block, uint64_t end) {
+    (void)jit; (void)nes; (void)block; (void)end;
+    return 0;
+}
+
+#endif
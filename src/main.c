@@ -1,42 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <SDL.h>
-#include "../includes/cpu.h"
-#include "../includes/ppu.h"
+#include "../includes/nes.h"
+#include "../includes/triple_buffer.h"
+#include "../includes/palette.h"
+#ifdef CPU_TRACE
+#include "../includes/trace.h"
+#endif
 
 #define SCREEN_WIDTH 256
 #define SCREEN_HEIGHT 240
 #define SCALE_FACTOR 3  // Agrandir l'écran x3 (768x720)
-
-// Palette NES complète (64 couleurs)
-static const uint32_t NES_PALETTE[64] = {
-    0x7C7C7C, 0x0000FC, 0x0000BC, 0x4428BC, 0x940084, 0xA80020, 0xA81000, 0x881400,
-    0x503000, 0x007800, 0x006800, 0x005800, 0x004058, 0x000000, 0x000000, 0x000000,
-    0xBCBCBC, 0x0078F8, 0x0058F8, 0x6844FC, 0xD800CC, 0xE40058, 0xF83800, 0xE45C10,
-    0xAC7C00, 0x00B800, 0x00A800, 0x00A844, 0x008888, 0x000000, 0x000000, 0x000000,
-    0xF8F8F8, 0x3CBCFC, 0x6888FC, 0x9878F8, 0xF878F8, 0xF85898, 0xF87858, 0xFCA044,
-    0xF8B800, 0xB8F818, 0x58D854, 0x58F898, 0x00E8D8, 0x787878, 0x000000, 0x000000,
-    0xFCFCFC, 0xA4E4FC, 0xB8B8F8, 0xD8B8F8, 0xF8B8F8, 0xF8A4C0, 0xF0D0B0, 0xFCE0A8,
-    0xF8D878, 0xD8F878, 0xB8F8B8, 0xB8F8D8, 0x00FCFC, 0xF8D8F8, 0x000000, 0x000000
-};
+#define NES_FRAME_RATE 60.0988  // NTSC: 1789773 CPU cycles/s / 29780.5 per frame
 
 // Variables globales pour SDL
 typedef struct {
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *texture;
-    uint32_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    PaletteLut palette;
 } Display;
 
-// Callback NMI appelé par le PPU
-static CPU *global_cpu = NULL;
-
-void nmi_callback(void) {
-    if (global_cpu) {
-        cpu_nmi(global_cpu);
-    }
-}
+// Emulation thread: runs the NES at its own frame rate and publishes frames,
+// the SDL thread presents the newest one (vsync only blocks the display)
+typedef struct {
+    NES *nes;
+    TripleBuffer *frames;
+    _Atomic uint8_t buttons;  // Bit i = key[i], written by the SDL thread
+    _Atomic bool running;
+    pthread_t thread;
+} Emulator;
 
 // Initialiser l'affichage SDL
 int init_display(Display *display) {
@@ -89,7 +86,9 @@ int init_display(Display *display) {
         return 1;
     }
 
-    printf("✅ SDL initialized successfully\n");
+    palette_build_lut(&display->palette);
+
+    printf("✅ SDL initialized successfully (%s palette kernel)\n", display->palette.kernel_name);
     return 0;
 }
 
@@ -101,101 +100,203 @@ void cleanup_display(Display *display) {
     SDL_Quit();
 }
 
-void render_frame(Display *display, PPU *ppu) {
+// Palette lookup straight into the texture memory: no intermediate ARGB copy
+void render_frame(Display *display, const Frame *frame) {
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(display->texture, NULL, &pixels, &pitch) != 0) {
+        fprintf(stderr, "❌ SDL_LockTexture Error: %s\n", SDL_GetError());
+        return;
+    }
+
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            uint8_t color_index = ppu->framebuffer[y * SCREEN_WIDTH + x] & 0x3F;
-            
-            uint32_t rgb_color = NES_PALETTE[color_index];
-            display->pixels[y * SCREEN_WIDTH + x] = 0xFF000000 | rgb_color;
-        }
+        uint32_t *row = (uint32_t *)((uint8_t *)pixels + y * pitch);
+        palette_convert_line(&display->palette, frame->emphasis[y], row, &frame->pixels[y * SCREEN_WIDTH], SCREEN_WIDTH);
     }
+    SDL_UnlockTexture(display->texture);
 
-    SDL_UpdateTexture(display->texture, NULL, display->pixels, SCREEN_WIDTH * sizeof(uint32_t));
     SDL_RenderClear(display->renderer);
     SDL_RenderCopy(display->renderer, display->texture, NULL, NULL);
     SDL_RenderPresent(display->renderer);
 }
 
-void handle_input(SDL_Event *event, CPU *cpu, bool *running) {
+// Bit of the key in CPU::key / Emulator::buttons, -1 if not mapped
+static int key_button(SDL_Keycode key) {
+    switch (key) {
+        case SDLK_x:       return 0; // A
+        case SDLK_z:       return 1; // B
+        case SDLK_RSHIFT:  return 2; // Select
+        case SDLK_RETURN:  return 3; // Start
+        case SDLK_UP:      return 4; // Up
+        case SDLK_DOWN:    return 5; // Down
+        case SDLK_LEFT:    return 6; // Left
+        case SDLK_RIGHT:   return 7; // Right
+        default:           return -1;
+    }
+}
+
+void handle_input(SDL_Event *event, Emulator *emu, bool *running) {
     while (SDL_PollEvent(event)) {
         if (event->type == SDL_QUIT) {
             *running = false;
         }
         
         if (event->type == SDL_KEYDOWN) {
-            switch (event->key.keysym.sym) {
-                case SDLK_ESCAPE:  *running = false; break;
-                case SDLK_x:       cpu->key[0] = 1; break; // A
-                case SDLK_z:       cpu->key[1] = 1; break; // B
-                case SDLK_RSHIFT:  cpu->key[2] = 1; break; // Select
-                case SDLK_RETURN:  cpu->key[3] = 1; break; // Start
-                case SDLK_UP:      cpu->key[4] = 1; break; // Up
-                case SDLK_DOWN:    cpu->key[5] = 1; break; // Down
-                case SDLK_LEFT:    cpu->key[6] = 1; break; // Left
-                case SDLK_RIGHT:   cpu->key[7] = 1; break; // Right
+            if (event->key.keysym.sym == SDLK_ESCAPE) {
+                *running = false;
+            }
+            int button = key_button(event->key.keysym.sym);
+            if (button >= 0) {
+                atomic_fetch_or_explicit(&emu->buttons, 1 << button, memory_order_relaxed);
             }
         }
         
         if (event->type == SDL_KEYUP) {
-            switch (event->key.keysym.sym) {
-                case SDLK_x:       cpu->key[0] = 0; break;
-                case SDLK_z:       cpu->key[1] = 0; break;
-                case SDLK_RSHIFT:  cpu->key[2] = 0; break;
-                case SDLK_RETURN:  cpu->key[3] = 0; break;
-                case SDLK_UP:      cpu->key[4] = 0; break;
-                case SDLK_DOWN:    cpu->key[5] = 0; break;
-                case SDLK_LEFT:    cpu->key[6] = 0; break;
-                case SDLK_RIGHT:   cpu->key[7] = 0; break;
+            int button = key_button(event->key.keysym.sym);
+            if (button >= 0) {
+                atomic_fetch_and_explicit(&emu->buttons, ~(1 << button), memory_order_relaxed);
             }
         }
     }
 }
 
+// === Emulation thread ===
+
+static void *emulation_thread(void *arg) {
+    Emulator *emu = arg;
+    CPU *cpu = &emu->nes->cpu;
+    PPU *ppu = &emu->nes->ppu;
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    uint64_t frame_ticks = (uint64_t)(frequency / NES_FRAME_RATE);
+    uint64_t deadline = SDL_GetPerformanceCounter();
+
+    while (atomic_load_explicit(&emu->running, memory_order_acquire)) {
+        // Buttons once per frame: nes_run_frame samples `key` for the whole
+        // frame, the game sees it through the $4016 strobe
+        uint8_t buttons = atomic_load_explicit(&emu->buttons, memory_order_relaxed);
+        for (int i = 0; i < 8; i++) {
+            cpu->key[i] = (buttons >> i) & 1;
+        }
+
+        // CPU + PPU until the next frame, then hand it to the SDL thread
+        nes_run_frame(cpu);
+        Frame *frame = triple_buffer_back(emu->frames);
+        memcpy(frame->pixels, ppu->framebuffer, sizeof(frame->pixels));
+        memcpy(frame->emphasis, ppu->line_emphasis, sizeof(frame->emphasis));
+        triple_buffer_publish(emu->frames);
+
+        if (ppu->frame_count % 60 == 0) {
+            printf("Frame: %llu, PC: 0x%04X, A: 0x%02X, X: 0x%02X, Y: 0x%02X\n",
+                   (unsigned long long)ppu->frame_count, cpu->PC, cpu->A, cpu->X, cpu->Y);
+        }
+
+        // Real-time pacing, on the NES clock instead of the display's
+        deadline += frame_ticks;
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (now < deadline) {
+            SDL_Delay((uint32_t)((deadline - now) * 1000 / frequency));
+        } else if (now - deadline > frame_ticks * 4) {
+            deadline = now;  // Too far behind (debugger, slow host): don't rush to catch up
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s <ROM file> [--accurate]\n", name);
+    printf("Controls:\n");
+    printf("  Arrow keys : D-Pad\n");
+    printf("  Z          : B button\n");
+    printf("  X          : A button\n");
+    printf("  Enter      : Start\n");
+    printf("  Right Shift: Select\n");
+    printf("  ESC        : Quit\n");
+    printf("--accurate: dot-based PPU for games with raster tricks\n");
+#ifdef CPU_TRACE
+    printf("Trace build: %s <ROM file> [--accurate] [trace file]\n", name);
+#endif
+}
+
 int main(int argc, char **argv) {
     if (argc < 2) {
-        printf("Usage: %s <ROM file>\n", argv[0]);
-        printf("Controls:\n");
-        printf("  Arrow keys : D-Pad\n");
-        printf("  Z          : B button\n");
-        printf("  X          : A button\n");
-        printf("  Enter      : Start\n");
-        printf("  Right Shift: Select\n");
-        printf("  ESC        : Quit\n");
+        usage(argv[0]);
         return 1;
     }
 
     const char *rom_path = argv[1];
+#ifdef CPU_TRACE
+    const char *trace_path = NULL;
+#endif
+    PpuTier tier = PPU_TIER_FAST;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--accurate") == 0) {
+            tier = PPU_TIER_ACCURATE;
+#ifdef CPU_TRACE
+        } else if (argv[i][0] != '-' && !trace_path) {
+            trace_path = argv[i];
+#endif
+        } else {
+            fprintf(stderr, "❌ Unknown option: %s\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
     // === Init CPU & PPU ===
-    CPU cpu;
-    PPU ppu;
-
-    nes_init(&cpu);
-    ppu_init(&ppu);
-    
-    cpu_connect_ppu(&cpu, &ppu);
-    
-
-    global_cpu = &cpu;
-    ppu_set_nmi_callback(&ppu, nmi_callback);
+    NES *nes = nes_create();
+    if (!nes) {
+        fprintf(stderr, "❌ Out of memory\n");
+        return 1;
+    }
+    CPU *cpu = &nes->cpu;
+    PPU *ppu = &nes->ppu;
 
     // === Load ROM ===
-    if (load_program(&cpu, rom_path) != 0) {
+    if (nes_load(nes, rom_path) != 0) {
         fprintf(stderr, "❌ Failed to load ROM: %s\n", rom_path);
+        nes_destroy(nes);
         return 1;
     }
     
 
-    printf("✅ ROM loaded successfully. PC at 0x%04X\n", cpu.PC);
+    printf("✅ ROM loaded successfully. PC at 0x%04X\n", cpu->PC);
 
-    printf("PPU: first nametable tile at $2000: %02X\n", nes_read(&cpu, 0x2000));
-    printf("PPU: first CHR-ROM tile: %02X\n", ppu.chr_rom[0]);
+    nes_set_tier(cpu, tier);
+    printf("ℹ️ Accuracy tier: %s\n", ppu->tier->name);
+
+#ifdef CPU_TRACE
+    Trace trace = {0};
+    if (trace_path) {
+        if (trace_open(&trace, trace_path) != 0) {
+            nes_destroy(nes);
+            return 1;
+        }
+        cpu->trace = &trace;
+    }
+#endif
+
+    printf("PPU: first nametable tile at $2000: %02X\n", nes_read(cpu, 0x2000));
+    printf("PPU: first CHR-ROM tile: %02X\n", ppu->chr_rom[0]);
 
 
     // === Init SDL ===
     Display display = {0};
     if (init_display(&display) != 0) {
+        nes_destroy(nes);
+        return 1;
+    }
+
+    // === Emulation thread ===
+    static TripleBuffer frames;
+    triple_buffer_init(&frames);
+
+    Emulator emu = { .nes = nes, .frames = &frames };
+    atomic_store(&emu.buttons, 0);
+    atomic_store(&emu.running, true);
+    if (pthread_create(&emu.thread, NULL, emulation_thread, &emu) != 0) {
+        fprintf(stderr, "❌ Cannot start emulation thread\n");
+        cleanup_display(&display);
+        nes_destroy(nes);
         return 1;
     }
 
@@ -206,27 +307,26 @@ int main(int argc, char **argv) {
     printf("✅ Emulator started. Press ESC to quit.\n");
 
     while (running) {
-        handle_input(&event, &cpu, &running);
-
-        nes_emulation_cycle(&cpu);
-        
-        // PPU x3 than the CPU
-        ppu_step(&ppu);
-        ppu_step(&ppu);
-        ppu_step(&ppu);
-
-        if (ppu.draw_flag) {
-            render_frame(&display, &ppu);
-            ppu.draw_flag = false;
-            
-            if (ppu.frame_count % 60 == 0) {
-                printf("Frame: %llu, PC: 0x%04X, A: 0x%02X, X: 0x%02X, Y: 0x%02X\n",
-                       ppu.frame_count, cpu.PC, cpu.A, cpu.X, cpu.Y);
-            }
+        handle_input(&event, &emu, &running);
+
+        // Newest finished frame, if any: vsync in SDL_RenderPresent only holds
+        // this thread
+        const Frame *frame = triple_buffer_acquire(&frames);
+        if (!frame) {
+            SDL_Delay(1);
+            continue;
         }
+        render_frame(&display, frame);
     }
 
+    atomic_store(&emu.running, false);
+    pthread_join(emu.thread, NULL);
+
     cleanup_display(&display);
+#ifdef CPU_TRACE
+    trace_close(&trace);
+#endif
+    nes_destroy(nes);
     printf("✅ Emulator closed properly\n");
     
     return 0;
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include "../includes/nes.h"
+
+// PPU -> CPU: the vblank NMI of this console
+static void nes_nmi(void *context) {
+    cpu_nmi((CPU *)context);
+}
+
+NES *nes_create(void) {
+    NES *nes = calloc(1, sizeof(NES));
+    if (!nes) {
+        return NULL;
+    }
+
+    nes_init(&nes->cpu);
+    ppu_init(&nes->ppu);
+    cpu_connect_ppu(&nes->cpu, &nes->ppu);
+    ppu_set_nmi_callback(&nes->ppu, nes_nmi, &nes->cpu);
+    return nes;
+}
+
+void nes_destroy(NES *nes) {
+    if (!nes) return;
+
+    cpu_enable_block_cache(&nes->cpu, false);  // Also frees the JIT
+    free(nes);
+}
+
+int nes_load(NES *nes, const char *filename) {
+    return load_program(&nes->cpu, filename);
+}
@@ -0,0 +1,269 @@
+#include "../includes/opcodes.h"
+
+// Operand bytes per addressing mode
+const uint8_t addr_mode_size[AM_COUNT] = {
+    [AM_IMP] = 0, [AM_ACC] = 0, [AM_IMM] = 1, [AM_ZP]  = 1, [AM_ZPX] = 1,
+    [AM_ZPY] = 1, [AM_ABS] = 2, [AM_ABX] = 2, [AM_ABY] = 2, [AM_IND] = 2,
+    [AM_IZX] = 1, [AM_IZY] = 1, [AM_REL] = 1
+};
+
+// Decode table: mnemonic, operation, addressing mode, base cycles, page-cross penalty.
+// Branches get +1 when taken and +1 more when the target is on another page (see cpu.c).
+const Opcode opcode_table[256] = {
+    /* 00 */ {"BRK", OP_BRK, AM_IMP, 7, 0},
+    /* 01 */ {"ORA", OP_ORA, AM_IZX, 6, 0},
+    /* 02 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 03 */ {"SLO", OP_SLO, AM_IZX, 8, 0},
+    /* 04 */ {"NOP", OP_NOP, AM_ZP, 3, 0},
+    /* 05 */ {"ORA", OP_ORA, AM_ZP, 3, 0},
+    /* 06 */ {"ASL", OP_ASL, AM_ZP, 5, 0},
+    /* 07 */ {"SLO", OP_SLO, AM_ZP, 5, 0},
+    /* 08 */ {"PHP", OP_PHP, AM_IMP, 3, 0},
+    /* 09 */ {"ORA", OP_ORA, AM_IMM, 2, 0},
+    /* 0A */ {"ASL", OP_ASL, AM_ACC, 2, 0},
+    /* 0B */ {"ANC", OP_ANC, AM_IMM, 2, 0},
+    /* 0C */ {"NOP", OP_NOP, AM_ABS, 4, 0},
+    /* 0D */ {"ORA", OP_ORA, AM_ABS, 4, 0},
+    /* 0E */ {"ASL", OP_ASL, AM_ABS, 6, 0},
+    /* 0F */ {"SLO", OP_SLO, AM_ABS, 6, 0},
+    /* 10 */ {"BPL", OP_BPL, AM_REL, 2, 0},
+    /* 11 */ {"ORA", OP_ORA, AM_IZY, 5, 1},
+    /* 12 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 13 */ {"SLO", OP_SLO, AM_IZY, 8, 0},
+    /* 14 */ {"NOP", OP_NOP, AM_ZPX, 4, 0},
+    /* 15 */ {"ORA", OP_ORA, AM_ZPX, 4, 0},
+    /* 16 */ {"ASL", OP_ASL, AM_ZPX, 6, 0},
+    /* 17 */ {"SLO", OP_SLO, AM_ZPX, 6, 0},
+    /* 18 */ {"CLC", OP_CLC, AM_IMP, 2, 0},
+    /* 19 */ {"ORA", OP_ORA, AM_ABY, 4, 1},
+    /* 1A */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* 1B */ {"SLO", OP_SLO, AM_ABY, 7, 0},
+    /* 1C */ {"NOP", OP_NOP, AM_ABX, 4, 1},
+    /* 1D */ {"ORA", OP_ORA, AM_ABX, 4, 1},
+    /* 1E */ {"ASL", OP_ASL, AM_ABX, 7, 0},
+    /* 1F */ {"SLO", OP_SLO, AM_ABX, 7, 0},
+    /* 20 */ {"JSR", OP_JSR, AM_ABS, 6, 0},
+    /* 21 */ {"AND", OP_AND, AM_IZX, 6, 0},
+    /* 22 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 23 */ {"RLA", OP_RLA, AM_IZX, 8, 0},
+    /* 24 */ {"BIT", OP_BIT, AM_ZP, 3, 0},
+    /* 25 */ {"AND", OP_AND, AM_ZP, 3, 0},
+    /* 26 */ {"ROL", OP_ROL, AM_ZP, 5, 0},
+    /* 27 */ {"RLA", OP_RLA, AM_ZP, 5, 0},
+    /* 28 */ {"PLP", OP_PLP, AM_IMP, 4, 0},
+    /* 29 */ {"AND", OP_AND, AM_IMM, 2, 0},
+    /* 2A */ {"ROL", OP_ROL, AM_ACC, 2, 0},
+    /* 2B */ {"ANC", OP_ANC, AM_IMM, 2, 0},
+    /* 2C */ {"BIT", OP_BIT, AM_ABS, 4, 0},
+    /* 2D */ {"AND", OP_AND, AM_ABS, 4, 0},
+    /* 2E */ {"ROL", OP_ROL, AM_ABS, 6, 0},
+    /* 2F */ {"RLA", OP_RLA, AM_ABS, 6, 0},
+    /* 30 */ {"BMI", OP_BMI, AM_REL, 2, 0},
+    /* 31 */ {"AND", OP_AND, AM_IZY, 5, 1},
+    /* 32 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 33 */ {"RLA", OP_RLA, AM_IZY, 8, 0},
+    /* 34 */ {"NOP", OP_NOP, AM_ZPX, 4, 0},
+    /* 35 */ {"AND", OP_AND, AM_ZPX, 4, 0},
+    /* 36 */ {"ROL", OP_ROL, AM_ZPX, 6, 0},
+    /* 37 */ {"RLA", OP_RLA, AM_ZPX, 6, 0},
+    /* 38 */ {"SEC", OP_SEC, AM_IMP, 2, 0},
+    /* 39 */ {"AND", OP_AND, AM_ABY, 4, 1},
+    /* 3A */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* 3B */ {"RLA", OP_RLA, AM_ABY, 7, 0},
+    /* 3C */ {"NOP", OP_NOP, AM_ABX, 4, 1},
+    /* 3D */ {"AND", OP_AND, AM_ABX, 4, 1},
+    /* 3E */ {"ROL", OP_ROL, AM_ABX, 7, 0},
+    /* 3F */ {"RLA", OP_RLA, AM_ABX, 7, 0},
+    /* 40 */ {"RTI", OP_RTI, AM_IMP, 6, 0},
+    /* 41 */ {"EOR", OP_EOR, AM_IZX, 6, 0},
+    /* 42 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 43 */ {"SRE", OP_SRE, AM_IZX, 8, 0},
+    /* 44 */ {"NOP", OP_NOP, AM_ZP, 3, 0},
+    /* 45 */ {"EOR", OP_EOR, AM_ZP, 3, 0},
+    /* 46 */ {"LSR", OP_LSR, AM_ZP, 5, 0},
+    /* 47 */ {"SRE", OP_SRE, AM_ZP, 5, 0},
+    /* 48 */ {"PHA", OP_PHA, AM_IMP, 3, 0},
+    /* 49 */ {"EOR", OP_EOR, AM_IMM, 2, 0},
+    /* 4A */ {"LSR", OP_LSR, AM_ACC, 2, 0},
+    /* 4B */ {"ALR", OP_ALR, AM_IMM, 2, 0},
+    /* 4C */ {"JMP", OP_JMP, AM_ABS, 3, 0},
+    /* 4D */ {"EOR", OP_EOR, AM_ABS, 4, 0},
+    /* 4E */ {"LSR", OP_LSR, AM_ABS, 6, 0},
+    /* 4F */ {"SRE", OP_SRE, AM_ABS, 6, 0},
+    /* 50 */ {"BVC", OP_BVC, AM_REL, 2, 0},
+    /* 51 */ {"EOR", OP_EOR, AM_IZY, 5, 1},
+    /* 52 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 53 */ {"SRE", OP_SRE, AM_IZY, 8, 0},
+    /* 54 */ {"NOP", OP_NOP, AM_ZPX, 4, 0},
+    /* 55 */ {"EOR", OP_EOR, AM_ZPX, 4, 0},
+    /* 56 */ {"LSR", OP_LSR, AM_ZPX, 6, 0},
+    /* 57 */ {"SRE", OP_SRE, AM_ZPX, 6, 0},
+    /* 58 */ {"CLI", OP_CLI, AM_IMP, 2, 0},
+    /* 59 */ {"EOR", OP_EOR, AM_ABY, 4, 1},
+    /* 5A */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* 5B */ {"SRE", OP_SRE, AM_ABY, 7, 0},
+    /* 5C */ {"NOP", OP_NOP, AM_ABX, 4, 1},
+    /* 5D */ {"EOR", OP_EOR, AM_ABX, 4, 1},
+    /* 5E */ {"LSR", OP_LSR, AM_ABX, 7, 0},
+    /* 5F */ {"SRE", OP_SRE, AM_ABX, 7, 0},
+    /* 60 */ {"RTS", OP_RTS, AM_IMP, 6, 0},
+    /* 61 */ {"ADC", OP_ADC, AM_IZX, 6, 0},
+    /* 62 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 63 */ {"RRA", OP_RRA, AM_IZX, 8, 0},
+    /* 64 */ {"NOP", OP_NOP, AM_ZP, 3, 0},
+    /* 65 */ {"ADC", OP_ADC, AM_ZP, 3, 0},
+    /* 66 */ {"ROR", OP_ROR, AM_ZP, 5, 0},
+    /* 67 */ {"RRA", OP_RRA, AM_ZP, 5, 0},
+    /* 68 */ {"PLA", OP_PLA, AM_IMP, 4, 0},
+    /* 69 */ {"ADC", OP_ADC, AM_IMM, 2, 0},
+    /* 6A */ {"ROR", OP_ROR, AM_ACC, 2, 0},
+    /* 6B */ {"ARR", OP_ARR, AM_IMM, 2, 0},
+    /* 6C */ {"JMP", OP_JMP, AM_IND, 5, 0},
+    /* 6D */ {"ADC", OP_ADC, AM_ABS, 4, 0},
+    /* 6E */ {"ROR", OP_ROR, AM_ABS, 6, 0},
+    /* 6F */ {"RRA", OP_RRA, AM_ABS, 6, 0},
+    /* 70 */ {"BVS", OP_BVS, AM_REL, 2, 0},
+    /* 71 */ {"ADC", OP_ADC, AM_IZY, 5, 1},
+    /* 72 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 73 */ {"RRA", OP_RRA, AM_IZY, 8, 0},
+    /* 74 */ {"NOP", OP_NOP, AM_ZPX, 4, 0},
+    /* 75 */ {"ADC", OP_ADC, AM_ZPX, 4, 0},
+    /* 76 */ {"ROR", OP_ROR, AM_ZPX, 6, 0},
+    /* 77 */ {"RRA", OP_RRA, AM_ZPX, 6, 0},
+    /* 78 */ {"SEI", OP_SEI, AM_IMP, 2, 0},
+    /* 79 */ {"ADC", OP_ADC, AM_ABY, 4, 1},
+    /* 7A */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* 7B */ {"RRA", OP_RRA, AM_ABY, 7, 0},
+    /* 7C */ {"NOP", OP_NOP, AM_ABX, 4, 1},
+    /* 7D */ {"ADC", OP_ADC, AM_ABX, 4, 1},
+    /* 7E */ {"ROR", OP_ROR, AM_ABX, 7, 0},
+    /* 7F */ {"RRA", OP_RRA, AM_ABX, 7, 0},
+    /* 80 */ {"NOP", OP_NOP, AM_IMM, 2, 0},
+    /* 81 */ {"STA", OP_STA, AM_IZX, 6, 0},
+    /* 82 */ {"NOP", OP_NOP, AM_IMM, 2, 0},
+    /* 83 */ {"SAX", OP_SAX, AM_IZX, 6, 0},
+    /* 84 */ {"STY", OP_STY, AM_ZP, 3, 0},
+    /* 85 */ {"STA", OP_STA, AM_ZP, 3, 0},
+    /* 86 */ {"STX", OP_STX, AM_ZP, 3, 0},
+    /* 87 */ {"SAX", OP_SAX, AM_ZP, 3, 0},
+    /* 88 */ {"DEY", OP_DEY, AM_IMP, 2, 0},
+    /* 89 */ {"NOP", OP_NOP, AM_IMM, 2, 0},
+    /* 8A */ {"TXA", OP_TXA, AM_IMP, 2, 0},
+    /* 8B */ {"XAA", OP_XAA, AM_IMM, 2, 0},
+    /* 8C */ {"STY", OP_STY, AM_ABS, 4, 0},
+    /* 8D */ {"STA", OP_STA, AM_ABS, 4, 0},
+    /* 8E */ {"STX", OP_STX, AM_ABS, 4, 0},
+    /* 8F */ {"SAX", OP_SAX, AM_ABS, 4, 0},
+    /* 90 */ {"BCC", OP_BCC, AM_REL, 2, 0},
+    /* 91 */ {"STA", OP_STA, AM_IZY, 6, 0},
+    /* 92 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* 93 */ {"SHA", OP_SHA, AM_IZY, 6, 0},
+    /* 94 */ {"STY", OP_STY, AM_ZPX, 4, 0},
+    /* 95 */ {"STA", OP_STA, AM_ZPX, 4, 0},
+    /* 96 */ {"STX", OP_STX, AM_ZPY, 4, 0},
+    /* 97 */ {"SAX", OP_SAX, AM_ZPY, 4, 0},
+    /* 98 */ {"TYA", OP_TYA, AM_IMP, 2, 0},
+    /* 99 */ {"STA", OP_STA, AM_ABY, 5, 0},
+    /* 9A */ {"TXS", OP_TXS, AM_IMP, 2, 0},
+    /* 9B */ {"TAS", OP_TAS, AM_ABY, 5, 0},
+    /* 9C */ {"SHY", OP_SHY, AM_ABX, 5, 0},
+    /* 9D */ {"STA", OP_STA, AM_ABX, 5, 0},
+    /* 9E */ {"SHX", OP_SHX, AM_ABY, 5, 0},
+    /* 9F */ {"SHA", OP_SHA, AM_ABY, 5, 0},
+    /* A0 */ {"LDY", OP_LDY, AM_IMM, 2, 0},
+    /* A1 */ {"LDA", OP_LDA, AM_IZX, 6, 0},
+    /* A2 */ {"LDX", OP_LDX, AM_IMM, 2, 0},
+    /* A3 */ {"LAX", OP_LAX, AM_IZX, 6, 0},
+    /* A4 */ {"LDY", OP_LDY, AM_ZP, 3, 0},
+    /* A5 */ {"LDA", OP_LDA, AM_ZP, 3, 0},
+    /* A6 */ {"LDX", OP_LDX, AM_ZP, 3, 0},
+    /* A7 */ {"LAX", OP_LAX, AM_ZP, 3, 0},
+    /* A8 */ {"TAY", OP_TAY, AM_IMP, 2, 0},
+    /* A9 */ {"LDA", OP_LDA, AM_IMM, 2, 0},
+    /* AA */ {"TAX", OP_TAX, AM_IMP, 2, 0},
+    /* AB */ {"LAX", OP_LAX, AM_IMM, 2, 0},
+    /* AC */ {"LDY", OP_LDY, AM_ABS, 4, 0},
+    /* AD */ {"LDA", OP_LDA, AM_ABS, 4, 0},
+    /* AE */ {"LDX", OP_LDX, AM_ABS, 4, 0},
+    /* AF */ {"LAX", OP_LAX, AM_ABS, 4, 0},
+    /* B0 */ {"BCS", OP_BCS, AM_REL, 2, 0},
+    /* B1 */ {"LDA", OP_LDA, AM_IZY, 5, 1},
+    /* B2 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* B3 */ {"LAX", OP_LAX, AM_IZY, 5, 1},
+    /* B4 */ {"LDY", OP_LDY, AM_ZPX, 4, 0},
+    /* B5 */ {"LDA", OP_LDA, AM_ZPX, 4, 0},
+    /* B6 */ {"LDX", OP_LDX, AM_ZPY, 4, 0},
+    /* B7 */ {"LAX", OP_LAX, AM_ZPY, 4, 0},
+    /* B8 */ {"CLV", OP_CLV, AM_IMP, 2, 0},
+    /* B9 */ {"LDA", OP_LDA, AM_ABY, 4, 1},
+    /* BA */ {"TSX", OP_TSX, AM_IMP, 2, 0},
+    /* BB */ {"LAS", OP_LAS, AM_ABY, 4, 1},
+    /* BC */ {"LDY", OP_LDY, AM_ABX, 4, 1},
+    /* BD */ {"LDA", OP_LDA, AM_ABX, 4, 1},
+    /* BE */ {"LDX", OP_LDX, AM_ABY, 4, 1},
+    /* BF */ {"LAX", OP_LAX, AM_ABY, 4, 1},
+    /* C0 */ {"CPY", OP_CPY, AM_IMM, 2, 0},
+    /* C1 */ {"CMP", OP_CMP, AM_IZX, 6, 0},
+    /* C2 */ {"NOP", OP_NOP, AM_IMM, 2, 0},
+    /* C3 */ {"DCP", OP_DCP, AM_IZX, 8, 0},
+    /* C4 */ {"CPY", OP_CPY, AM_ZP, 3, 0},
+    /* C5 */ {"CMP", OP_CMP, AM_ZP, 3, 0},
+    /* C6 */ {"DEC", OP_DEC, AM_ZP, 5, 0},
+    /* C7 */ {"DCP", OP_DCP, AM_ZP, 5, 0},
+    /* C8 */ {"INY", OP_INY, AM_IMP, 2, 0},
+    /* C9 */ {"CMP", OP_CMP, AM_IMM, 2, 0},
+    /* CA */ {"DEX", OP_DEX, AM_IMP, 2, 0},
+    /* CB */ {"SBX", OP_SBX, AM_IMM, 2, 0},
+    /* CC */ {"CPY", OP_CPY, AM_ABS, 4, 0},
+    /* CD */ {"CMP", OP_CMP, AM_ABS, 4, 0},
+    /* CE */ {"DEC", OP_DEC, AM_ABS, 6, 0},
+    /* CF */ {"DCP", OP_DCP, AM_ABS, 6, 0},
+    /* D0 */ {"BNE", OP_BNE, AM_REL, 2, 0},
+    /* D1 */ {"CMP", OP_CMP, AM_IZY, 5, 1},
+    /* D2 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* D3 */ {"DCP", OP_DCP, AM_IZY, 8, 0},
+    /* D4 */ {"NOP", OP_NOP, AM_ZPX, 4, 0},
+    /* D5 */ {"CMP", OP_CMP, AM_ZPX, 4, 0},
+    /* D6 */ {"DEC", OP_DEC, AM_ZPX, 6, 0},
+    /* D7 */ {"DCP", OP_DCP, AM_ZPX, 6, 0},
+    /* D8 */ {"CLD", OP_CLD, AM_IMP, 2, 0},
+    /* D9 */ {"CMP", OP_CMP, AM_ABY, 4, 1},
+    /* DA */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* DB */ {"DCP", OP_DCP, AM_ABY, 7, 0},
+    /* DC */ {"NOP", OP_NOP, AM_ABX, 4, 1},
+    /* DD */ {"CMP", OP_CMP, AM_ABX, 4, 1},
+    /* DE */ {"DEC", OP_DEC, AM_ABX, 7, 0},
+    /* DF */ {"DCP", OP_DCP, AM_ABX, 7, 0},
+    /* E0 */ {"CPX", OP_CPX, AM_IMM, 2, 0},
+    /* E1 */ {"SBC", OP_SBC, AM_IZX, 6, 0},
+    /* E2 */ {"NOP", OP_NOP, AM_IMM, 2, 0},
+    /* E3 */ {"ISC", OP_ISC, AM_IZX, 8, 0},
+    /* E4 */ {"CPX", OP_CPX, AM_ZP, 3, 0},
+    /* E5 */ {"SBC", OP_SBC, AM_ZP, 3, 0},
+    /* E6 */ {"INC", OP_INC, AM_ZP, 5, 0},
+    /* E7 */ {"ISC", OP_ISC, AM_ZP, 5, 0},
+    /* E8 */ {"INX", OP_INX, AM_IMP, 2, 0},
+    /* E9 */ {"SBC", OP_SBC, AM_IMM, 2, 0},
+    /* EA */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* EB */ {"SBC", OP_SBC, AM_IMM, 2, 0},
+    /* EC */ {"CPX", OP_CPX, AM_ABS, 4, 0},
+    /* ED */ {"SBC", OP_SBC, AM_ABS, 4, 0},
+    /* EE */ {"INC", OP_INC, AM_ABS, 6, 0},
+    /* EF */ {"ISC", OP_ISC, AM_ABS, 6, 0},
+    /* F0 */ {"BEQ", OP_BEQ, AM_REL, 2, 0},
+    /* F1 */ {"SBC", OP_SBC, AM_IZY, 5, 1},
+    /* F2 */ {"JAM", OP_JAM, AM_IMP, 2, 0},
+    /* F3 */ {"ISC", OP_ISC, AM_IZY, 8, 0},
+    /* F4 */ {"NOP", OP_NOP, AM_ZPX, 4, 0},
+    /* F5 */ {"SBC", OP_SBC, AM_ZPX, 4, 0},
+    /* F6 */ {"INC", OP_INC, AM_ZPX, 6, 0},
+    /* F7 */ {"ISC", OP_ISC, AM_ZPX, 6, 0},
+    /* F8 */ {"SED", OP_SED, AM_IMP, 2, 0},
+    /* F9 */ {"SBC", OP_SBC, AM_ABY, 4, 1},
+    /* FA */ {"NOP", OP_NOP, AM_IMP, 2, 0},
+    /* FB */ {"ISC", OP_ISC, AM_ABY, 7, 0},
+    /* FC */ {"NOP", OP_NOP, AM_ABX, 4, 1},
+    /* FD */ {"SBC", OP_SBC, AM_ABX, 4, 1},
+    /* FE */ {"INC", OP_INC, AM_ABX, 7, 0},
+    /* FF */ {"ISC", OP_ISC, AM_ABX, 7, 0},
+};
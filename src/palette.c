@@ -0,0 +1,140 @@
+#include "../includes/palette.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PALETTE_X86
+#include <immintrin.h>
+#endif
+
+// Palette NES complète (64 couleurs)
+const uint32_t NES_PALETTE[PALETTE_COLORS] = {
+    0x7C7C7C, 0x0000FC, 0x0000BC, 0x4428BC, 0x940084, 0xA80020, 0xA81000, 0x881400,
+    0x503000, 0x007800, 0x006800, 0x005800, 0x004058, 0x000000, 0x000000, 0x000000,
+    0xBCBCBC, 0x0078F8, 0x0058F8, 0x6844FC, 0xD800CC, 0xE40058, 0xF83800, 0xE45C10,
+    0xAC7C00, 0x00B800, 0x00A800, 0x00A844, 0x008888, 0x000000, 0x000000, 0x000000,
+    0xF8F8F8, 0x3CBCFC, 0x6888FC, 0x9878F8, 0xF878F8, 0xF85898, 0xF87858, 0xFCA044,
+    0xF8B800, 0xB8F818, 0x58D854, 0x58F898, 0x00E8D8, 0x787878, 0x000000, 0x000000,
+    0xFCFCFC, 0xA4E4FC, 0xB8B8F8, 0xD8B8F8, 0xF8B8F8, 0xF8A4C0, 0xF0D0B0, 0xFCE0A8,
+    0xF8D878, 0xD8F878, 0xB8F8B8, 0xB8F8D8, 0x00FCFC, 0xF8D8F8, 0x000000, 0x000000
+};
+
+// Each emphasis bit (R, G, B) dims the two other channels
+#define EMPHASIS_DIM 0.816
+
+static void palette_convert_scalar(const PaletteLut *lut, uint8_t emphasis, uint32_t *dst, const uint8_t *src, int count) {
+    const uint32_t *table = &lut->argb[emphasis * PALETTE_COLORS];
+    for (int x = 0; x < count; x++) {
+        dst[x] = table[src[x] & 0x3F];
+    }
+}
+
+#ifdef PALETTE_X86
+// 8 pixels per gather
+__attribute__((target("avx2")))
+static void palette_convert_avx2(const PaletteLut *lut, uint8_t emphasis, uint32_t *dst, const uint8_t *src, int count) {
+    const uint32_t *table = &lut->argb[emphasis * PALETTE_COLORS];
+    const __m256i color_mask = _mm256_set1_epi32(0x3F);
+    int x = 0;
+
+    for (; x + 8 <= count; x += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&src[x]));
+        index = _mm256_and_si256(index, color_mask);
+        __m256i argb = _mm256_i32gather_epi32((const int *)table, index, 4);
+        _mm256_storeu_si256((__m256i *)&dst[x], argb);
+    }
+    for (; x < count; x++) {
+        dst[x] = table[src[x] & 0x3F];
+    }
+}
+
+// 16 pixels per iteration: pshufb looks up 16 colors at a time, so each channel
+// takes 4 lookups (one per group of 16 colors) merged on the index's bits 4-5,
+// then the B, G, R planes are interleaved back into ARGB pixels
+__attribute__((target("ssse3")))
+static void palette_convert_ssse3(const PaletteLut *lut, uint8_t emphasis, uint32_t *dst, const uint8_t *src, int count) {
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    const __m128i group_mask = _mm_set1_epi8(0x03);
+    const __m128i alpha = _mm_set1_epi8((char)0xFF);
+    __m128i planes[3][4];
+    for (int c = 0; c < 3; c++) {
+        for (int g = 0; g < 4; g++) {
+            planes[c][g] = _mm_loadu_si128((const __m128i *)lut->planes[emphasis][c][g]);
+        }
+    }
+    int x = 0;
+
+    for (; x + 16 <= count; x += 16) {
+        __m128i index = _mm_loadu_si128((const __m128i *)&src[x]);
+        __m128i low = _mm_and_si128(index, low_mask);
+        __m128i group = _mm_and_si128(_mm_srli_epi16(index, 4), group_mask);
+
+        __m128i in_group[4];
+#pragma GCC unroll 4
+        for (int g = 0; g < 4; g++) {
+            in_group[g] = _mm_cmpeq_epi8(group, _mm_set1_epi8(g));
+        }
+
+        __m128i channel[3];
+#pragma GCC unroll 3
+        for (int c = 0; c < 3; c++) {
+            channel[c] = _mm_setzero_si128();
+#pragma GCC unroll 4
+            for (int g = 0; g < 4; g++) {
+                channel[c] = _mm_or_si128(channel[c], _mm_and_si128(_mm_shuffle_epi8(planes[c][g], low), in_group[g]));
+            }
+        }
+
+        // Memory order of an ARGB8888 pixel: B, G, R, A
+        __m128i bg_low = _mm_unpacklo_epi8(channel[0], channel[1]);
+        __m128i bg_high = _mm_unpackhi_epi8(channel[0], channel[1]);
+        __m128i ra_low = _mm_unpacklo_epi8(channel[2], alpha);
+        __m128i ra_high = _mm_unpackhi_epi8(channel[2], alpha);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm_unpacklo_epi16(bg_low, ra_low));
+        _mm_storeu_si128((__m128i *)&dst[x + 4], _mm_unpackhi_epi16(bg_low, ra_low));
+        _mm_storeu_si128((__m128i *)&dst[x + 8], _mm_unpacklo_epi16(bg_high, ra_high));
+        _mm_storeu_si128((__m128i *)&dst[x + 12], _mm_unpackhi_epi16(bg_high, ra_high));
+    }
+    palette_convert_scalar(lut, emphasis, &dst[x], &src[x], count - x);
+}
+#endif
+
+void palette_build_lut(PaletteLut *lut) {
+    for (int emphasis = 0; emphasis < PALETTE_EMPHASIS; emphasis++) {
+        for (int color = 0; color < PALETTE_COLORS; color++) {
+            uint32_t rgb = NES_PALETTE[color];
+            double channel[3] = { (rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF };  // R, G, B
+
+            // Emphasis bit i stands for channel i, $xE/$xF stay black
+            if ((color & 0x0E) != 0x0E) {
+                for (int bit = 0; bit < 3; bit++) {
+                    if (!(emphasis & (1 << bit))) continue;
+                    for (int c = 0; c < 3; c++) {
+                        if (c != bit) channel[c] *= EMPHASIS_DIM;
+                    }
+                }
+            }
+
+            uint32_t argb = 0xFF000000 | ((uint32_t)channel[0] << 16) | ((uint32_t)channel[1] << 8) | (uint32_t)channel[2];
+            lut->argb[emphasis * PALETTE_COLORS + color] = argb;
+            for (int c = 0; c < 3; c++) {
+                lut->planes[emphasis][c][color / 16][color % 16] = (argb >> (c * 8)) & 0xFF;  // B, G, R
+            }
+        }
+    }
+
+    lut->kernel = palette_convert_scalar;
+    lut->kernel_name = "scalar";
+#ifdef PALETTE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        lut->kernel = palette_convert_avx2;
+        lut->kernel_name = "avx2";
+    } else if (__builtin_cpu_supports("ssse3")) {
+        lut->kernel = palette_convert_ssse3;
+        lut->kernel_name = "ssse3";
+    }
+#endif
+}
+
+void palette_convert_line(const PaletteLut *lut, uint8_t emphasis, uint32_t *dst, const uint8_t *src, int count) {
+    lut->kernel(lut, emphasis & (PALETTE_EMPHASIS - 1), dst, src, count);
+}
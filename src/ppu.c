@@ -1,17 +1,166 @@
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
 #include "../includes/ppu.h"
 
-static const uint32_t NES_PALETTE[64] = {
-    0x7C7C7C, 0x0000FC, 0x0000BC, 0x4428BC, 0x940084, 0xA80020, 0xA81000, 0x881400,
-    0x503000, 0x007800, 0x006800, 0x005800, 0x004058, 0x000000, 0x000000, 0x000000,
-    0xBCBCBC, 0x0078F8, 0x0058F8, 0x6844FC, 0xD800CC, 0xE40058, 0xF83800, 0xE45C10,
-    0xAC7C00, 0x00B800, 0x00A800, 0x00A844, 0x008888, 0x000000, 0x000000, 0x000000,
-    0xF8F8F8, 0x3CBCFC, 0x6888FC, 0x9878F8, 0xF878F8, 0xF85898, 0xF87858, 0xFCA044,
-    0xF8B800, 0xB8F818, 0x58D854, 0x58F898, 0x00E8D8, 0x787878, 0x000000, 0x000000,
-    0xFCFCFC, 0xA4E4FC, 0xB8B8F8, 0xD8B8F8, 0xF8B8F8, 0xF8A4C0, 0xF0D0B0, 0xFCE0A8,
-    0xF8D878, 0xD8F878, 0xB8F8B8, 0xB8F8D8, 0x00FCFC, 0xF8D8F8, 0x000000, 0x000000
-};
+// === Instrumentation ===
+#ifdef PPU_STATS
+static void ppu_count_access(PPU *ppu, uint16_t addr, uint8_t value, bool write) {
+    PpuRegion region = ppu_region(addr);
+    if (write) ppu->stats.writes[region]++;
+    else ppu->stats.reads[region]++;
+
+    if (ppu->stats.log_every && ++ppu->stats.log_countdown >= ppu->stats.log_every) {
+        ppu->stats.log_countdown = 0;
+        printf("PPU %s %s: $%04X = $%02X (line %d, dot %d)\n", write ? "write" : "read",
+               ppu_region_name(region), addr & 0x3FFF, value, ppu->scanline, ppu->cycle);
+    }
+}
+#define PPU_COUNT_ACCESS(ppu, addr, value, write) ppu_count_access((ppu), (addr), (value), (write))
+#else
+#define PPU_COUNT_ACCESS(ppu, addr, value, write) ((void)0)
+#endif
+
+// === Tile decoding ===
+// tile_spread[b] puts bit 7-x of b into byte x: a pattern row decodes as
+// spread[low] | spread[high] << 1, 8 pixels of 2 bits in one go. Both tables
+// are built by the compiler, so no PPU instance writes shared state.
+#define TILE_SPREAD_BIT(b, x) ((uint64_t)(((b) >> (7 - (x))) & 1) << ((x) * 8))
+#define TILE_SPREAD(b) (TILE_SPREAD_BIT(b, 0) | TILE_SPREAD_BIT(b, 1) | TILE_SPREAD_BIT(b, 2) | TILE_SPREAD_BIT(b, 3) | \
+                        TILE_SPREAD_BIT(b, 4) | TILE_SPREAD_BIT(b, 5) | TILE_SPREAD_BIT(b, 6) | TILE_SPREAD_BIT(b, 7))
+#define BIT_REVERSE_BIT(b, x) ((((b) >> (x)) & 1) << (7 - (x)))
+#define BIT_REVERSE(b) (BIT_REVERSE_BIT(b, 0) | BIT_REVERSE_BIT(b, 1) | BIT_REVERSE_BIT(b, 2) | BIT_REVERSE_BIT(b, 3) | \
+                        BIT_REVERSE_BIT(b, 4) | BIT_REVERSE_BIT(b, 5) | BIT_REVERSE_BIT(b, 6) | BIT_REVERSE_BIT(b, 7))
+
+#define LUT_4(f, n)   f(n), f(n + 1), f(n + 2), f(n + 3)
+#define LUT_16(f, n)  LUT_4(f, n), LUT_4(f, n + 4), LUT_4(f, n + 8), LUT_4(f, n + 12)
+#define LUT_64(f, n)  LUT_16(f, n), LUT_16(f, n + 16), LUT_16(f, n + 32), LUT_16(f, n + 48)
+#define LUT_256(f)    LUT_64(f, 0), LUT_64(f, 64), LUT_64(f, 128), LUT_64(f, 192)
+
+static const uint64_t tile_spread[256] = { LUT_256(TILE_SPREAD) };
+static const uint8_t bit_reverse[256] = { LUT_256(BIT_REVERSE) };  // Opacity masks of X-flipped sprites
+
+// Rebuild the 8 rows of a dirty tile from its two bitplanes
+static void ppu_decode_tile(PPU *ppu, uint16_t tile) {
+    const uint8_t *pattern = &ppu->chr_rom[tile * 16];
+    for (int row = 0; row < TILE_SIZE; row++) {
+        PPU_COUNT_ACCESS(ppu, tile * 16 + row, pattern[row], false);
+        PPU_COUNT_ACCESS(ppu, tile * 16 + row + 8, pattern[row + 8], false);
+        ppu->pattern_cache[tile][row] = tile_spread[pattern[row]] | (tile_spread[pattern[row + 8]] << 1);
+        ppu->pattern_opacity[tile][row] = pattern[row] | pattern[row + 8];
+    }
+    ppu->pattern_dirty[tile] = false;
+}
+
+// Tile number (0-511) in the pattern cache, decoded if it was dirty
+static inline uint16_t ppu_pattern_tile(PPU *ppu, uint16_t pattern_base, uint8_t tile_index) {
+    uint16_t tile = (pattern_base >> 4) + tile_index;
+    if (ppu->pattern_dirty[tile]) {
+        ppu_decode_tile(ppu, tile);
+    }
+    return tile;
+}
+
+// Byte x of the result is pixel x of the row (0-3)
+static inline uint64_t ppu_decode_tile_row(PPU *ppu, uint16_t pattern_base, uint8_t tile_index, uint8_t row) {
+    return ppu->pattern_cache[ppu_pattern_tile(ppu, pattern_base, tile_index)][row];
+}
+
+void ppu_invalidate_patterns(PPU *ppu, uint16_t addr, uint16_t length) {
+    if (length == 0) return;
+    int first = (addr & 0x1FFF) >> 4;
+    int last = ((addr & 0x1FFF) + length - 1) >> 4;
+    for (int tile = first; tile <= last && tile < PPU_PATTERN_TILES; tile++) {
+        ppu->pattern_dirty[tile] = true;
+    }
+    ppu->bg_stale = true;
+}
+
+// === Scrolling ===
+// Loopy registers (see PPU): both tiers keep v moving like the hardware does,
+// the accurate one dot by dot, the fast one at the end of each line
+
+static inline bool ppu_rendering(PPU *ppu) {
+    return ppu->mask & (PPUMASK_SHOW_BG | PPUMASK_SHOW_SPRITES);
+}
+
+static void ppu_increment_x(PPU *ppu) {
+    if ((ppu->addr & 0x001F) == 31) {
+        ppu->addr &= ~0x001F;
+        ppu->addr ^= 0x0400;  // Next horizontal nametable
+    } else {
+        ppu->addr++;
+    }
+}
+
+static void ppu_increment_y(PPU *ppu) {
+    if ((ppu->addr & 0x7000) != 0x7000) {
+        ppu->addr += 0x1000;  // Fine Y
+        return;
+    }
+
+    ppu->addr &= ~0x7000;
+    int coarse_y = (ppu->addr & 0x03E0) >> 5;
+    if (coarse_y == 29) {
+        coarse_y = 0;
+        ppu->addr ^= 0x0800;  // Next vertical nametable
+    } else if (coarse_y == 31) {
+        coarse_y = 0;  // Attribute rows: wrap without switching
+    } else {
+        coarse_y++;
+    }
+    ppu->addr = (ppu->addr & ~0x03E0) | (coarse_y << 5);
+}
+
+// Freeze the scroll of the current visible line for the fast renderer. Called
+// at dot 1 and 256, and before $2005-$2007 writes so a mid-line write only
+// shows from the next line on.
+static void ppu_latch_scroll(PPU *ppu) {
+    int line = ppu->scanline;
+    if (line < 0 || line >= SCREEN_HEIGHT || ppu->cycle < 1 || ppu->scroll_line == line) {
+        return;
+    }
+    ppu->line_scroll[line].v = ppu->addr;
+    ppu->line_scroll[line].fine_x = ppu->fine_x;
+    ppu->scroll_line = line;
+}
+
+// Top-left pixel of the current line inside the 512x480 plane of the four
+// nametables. Coarse Y 30-31 (attribute rows on hardware) wraps to the next one.
+static void ppu_line_origin(PPU *ppu, int *world_x, int *world_y) {
+    const PpuScroll *scroll = &ppu->line_scroll[ppu->scanline];
+    uint16_t v = scroll->v;
+
+    *world_x = ((v >> 10) & 0x01) * SCREEN_WIDTH + (v & 0x001F) * TILE_SIZE + scroll->fine_x;
+    *world_y = (((v >> 11) & 0x01) * SCREEN_HEIGHT + ((v >> 5) & 0x001F) * TILE_SIZE + ((v >> 12) & 0x07))
+               % (SCREEN_HEIGHT * 2);
+}
+
+// === Background layers ===
+
+// Nametable n ($2000 + n * $400) lives in vram[(n & 1) * $400], like ppu_read_memory
+static inline int ppu_nametable_layer(int nametable) {
+    return nametable & (PPU_NAMETABLES - 1);
+}
+
+// A nametable byte dirties its cell, an attribute byte the 4x4 cells it colors
+static void ppu_mark_bg_dirty(PPU *ppu, uint16_t addr) {
+    int layer = ppu_nametable_layer((addr >> 10) & 0x03);
+    int offset = addr & 0x03FF;
+
+    if (offset < 0x3C0) {
+        ppu->bg_dirty[layer][offset / PPU_NAMETABLE_COLS][offset % PPU_NAMETABLE_COLS] = true;
+        return;
+    }
+
+    int attrib_x = (offset - 0x3C0) % 8;
+    int attrib_y = (offset - 0x3C0) / 8;
+    for (int row = attrib_y * 4; row < attrib_y * 4 + 4 && row < PPU_NAMETABLE_ROWS; row++) {
+        for (int col = attrib_x * 4; col < attrib_x * 4 + 4; col++) {
+            ppu->bg_dirty[layer][row][col] = true;
+        }
+    }
+}
 
 // === Init ===
 
@@ -28,6 +177,7 @@ void ppu_init(PPU *ppu) {
     ppu->draw_flag = false;
     ppu->frame_count = 0;
     ppu->nmi_callback = NULL;
+    ppu->nmi_context = NULL;
 
     // for (int y = 0; y < 240; y++) {
     //     for (int x = 0; x < 256; x++) {
@@ -40,6 +190,11 @@ void ppu_init(PPU *ppu) {
     ppu->palette[1] = 0xC5;  // Blanc
     ppu->palette[2] = 0x16;  // Rouge
     ppu->palette[3] = 0x27;  // Orange
+
+    ppu_invalidate_patterns(ppu, 0x0000, sizeof(ppu->chr_rom));  // Also marks the layers stale
+    ppu->sprites_dirty = true;
+    ppu->scroll_line = -1;
+    ppu_set_tier(ppu, PPU_TIER_FAST);
 }
 
 void ppu_reset(PPU *ppu) {
@@ -47,29 +202,31 @@ void ppu_reset(PPU *ppu) {
     ppu->mask = 0;
     ppu->status = 0;
     ppu->oam_addr = 0;
-    ppu->scroll_x = 0;
-    ppu->scroll_y = 0;
+    ppu->temp_addr = 0;
+    ppu->fine_x = 0;
+    ppu->scroll_line = -1;
     ppu->addr = 0;
     ppu->data = 0;
     ppu->addr_latch = false;
     ppu->data_buffer = 0;
     ppu->scanline = -1;
     ppu->cycle = 0;
+    ppu->sprite0_dot = -1;
 }
 
 // === PPU memory access ===
 
 uint8_t ppu_read_memory(PPU *ppu, uint16_t addr) {
     addr &= 0x3FFF;  // Mirror
-    
+    uint8_t value;
+
     // Pattern tables (0x0000-0x1FFF)
     if (addr < 0x2000) {
-        return ppu->chr_rom[addr];
+        value = ppu->chr_rom[addr];
     }
     // Nametables (0x2000-0x2FFF)
     else if (addr < 0x3F00) {
-        printf("Reading nametable: $%04x\n", addr);
-        return ppu->vram[addr & 0x07FF];
+        value = ppu->vram[addr & 0x07FF];
     }
     // Palette (0x3F00-0x3FFF)
     else {
@@ -79,26 +236,33 @@ uint8_t ppu_read_memory(PPU *ppu, uint16_t addr) {
         if (p == 0x14) p = 0x04;
         if (p == 0x18) p = 0x08;
         if (p == 0x1C) p = 0x0C;
-        return ppu->palette[p] & 0x3F;
+        value = ppu->palette[p] & 0x3F;
     }
+
+    PPU_COUNT_ACCESS(ppu, addr, value, false);
+    return value;
 }
 
 void ppu_write_memory(PPU *ppu, uint16_t addr, uint8_t value) {
     addr &= 0x3FFF;
+    PPU_COUNT_ACCESS(ppu, addr, value, true);
     
     // Pattern tables (0x0000-0x1FFF)
     if (addr < 0x2000) {
         if (ppu->chr_ram_enabled) {
             ppu->chr_rom[addr] = value;  // CHR-RAM is writable
+            ppu->pattern_dirty[addr >> 4] = true;
+            ppu->bg_tile_changed[addr >> 4] = true;
+            ppu->bg_tiles_changed = true;
         }
         // CHR-ROM est read-only
     }
     // Nametables (0x2000-0x2FFF)
     else if (addr < 0x3F00) {
-        printf("Writing to nametable: $%04X = $%02X\n", addr, value);
         ppu->vram[addr & 0x07FF] = value;
+        ppu_mark_bg_dirty(ppu, addr);
     }
-    // Palette (0x3F00-0x3FFF)
+    // Palette (0x3F00-0x3FFF): the layers hold palette indices, nothing to redraw
     else {
         uint16_t p = addr & 0x1F;
         if (p == 0x10) p = 0x00;
@@ -109,9 +273,20 @@ void ppu_write_memory(PPU *ppu, uint16_t addr, uint8_t value) {
     }
 }
 
+void ppu_oam_dma(PPU *ppu, const uint8_t *data) {
+    for (int i = 0; i < 256; i++) {
+        ppu->oam[(uint8_t)(ppu->oam_addr + i)] = data[i];
+    }
+    ppu->sprites_dirty = true;
+}
+
 // === PPU Registres ===
 
 void ppu_write_register(PPU *ppu, uint16_t addr, uint8_t value) {
+    if ((addr & 0x0007) >= 0x0005) {
+        ppu_latch_scroll(ppu);  // x / v change under the line being drawn
+    }
+
     switch (addr & 0x2007) {
         case 0x2000:  // PPUCTRL
             ppu->ctrl = value;
@@ -129,25 +304,29 @@ void ppu_write_register(PPU *ppu, uint16_t addr, uint8_t value) {
             
         case 0x2004:  // OAMDATA
             ppu->oam[ppu->oam_addr++] = value;
+            ppu->sprites_dirty = true;
             break;
             
+        // PPUSCROLL / PPUADDR share the loopy t register (temp_addr):
+        // yyy NN YYYYY XXXXX = fine Y, nametable, coarse Y, coarse X
         case 0x2005:  // PPUSCROLL
             if (!ppu->addr_latch) {
-                ppu->scroll_x = value;
                 ppu->fine_x = value & 0x07;
+                ppu->temp_addr = (ppu->temp_addr & ~0x001F) | (value >> 3);
                 ppu->addr_latch = true;
             } else {
-                ppu->scroll_y = value;
+                ppu->temp_addr = (ppu->temp_addr & ~0x73E0) | ((value & 0x07) << 12) | ((value & 0xF8) << 2);
                 ppu->addr_latch = false;
             }
             break;
             
         case 0x2006:  // PPUADDR
             if (!ppu->addr_latch) {
-                ppu->addr = (ppu->addr & 0x00FF) | ((value & 0x3F) << 8); // High Byte
+                ppu->temp_addr = (ppu->temp_addr & 0x00FF) | ((value & 0x3F) << 8); // High Byte
                 ppu->addr_latch = true;
             } else {
-                ppu->addr = (ppu->addr & 0xFF00) | value; // Low Byte
+                ppu->temp_addr = (ppu->temp_addr & 0xFF00) | value; // Low Byte
+                ppu->addr = ppu->temp_addr;  // v = t on the second write
                 ppu->addr_latch = false;
             }
             break;
@@ -204,30 +383,22 @@ uint8_t ppu_read_register(PPU *ppu, uint16_t addr) {
 void ppu_get_tile_row(PPU *ppu, uint8_t tile_index, uint8_t row, uint8_t *pixels) {
     // Choose background pattern table base according to PPUCTRL bit $10
     uint16_t pattern_base = (ppu->ctrl & PPUCTRL_BG_PATTERN) ? 0x1000 : 0x0000;
-    uint16_t addr = pattern_base + ((uint16_t)tile_index << 4) + (row & 0x07);
-
-    uint8_t low_byte  = ppu->chr_rom[pattern_base + tile_index * 16 + row];
-    uint8_t high_byte = ppu->chr_rom[pattern_base + tile_index * 16 + row + 8];
+    uint64_t decoded = ppu_decode_tile_row(ppu, pattern_base, tile_index, row & 0x07);
 
     for (int x = 0; x < 8; x++) {
-        uint8_t bit_low  = (low_byte  >> (7 - x)) & 1;
-        uint8_t bit_high = (high_byte >> (7 - x)) & 1;
-        pixels[x] = (bit_high << 1) | bit_low;  // 0-3
+        pixels[x] = (decoded >> (x * 8)) & 0x03;  // 0-3
     }
 }
 
-uint8_t ppu_get_nametable_tile(PPU *ppu, int tile_x, int tile_y) {
-    // Nametable 0 start at $2000
-    uint16_t nametable_base = 0x2000 + ((ppu->ctrl & 0x03) << 10);
+uint8_t ppu_get_nametable_tile(PPU *ppu, uint16_t nametable_base, int tile_x, int tile_y) {
     uint16_t offset = (tile_y % 30) * 32 + (tile_x % 32);
     return ppu_read_memory(ppu, nametable_base + offset);
 
 }
 
-static uint8_t ppu_get_tile_palette_number(PPU *ppu, int tile_x, int tile_y) {
+static uint8_t ppu_get_tile_palette_number(PPU *ppu, uint16_t nametable_base, int tile_x, int tile_y) {
     // attribute table starts at ...0x23C0 for current nametable
     // attribute address calculation:
-    uint16_t nametable_base = 0x2000 + ((ppu->ctrl & 0x03) << 10);
     uint16_t attrib_x = tile_x / 4;
     uint16_t attrib_y = tile_y / 4;
     uint16_t attrib_addr = nametable_base + 0x3C0 + (attrib_y * 8) + attrib_x;
@@ -254,34 +425,310 @@ uint8_t ppu_get_background_color(PPU *ppu, uint8_t palette_num, uint8_t pixel_va
     return ppu->palette[palette_index] & 0x3F;
 }
 
-void ppu_render_scanline(PPU *ppu) {
-    if (ppu->scanline < 0 || ppu->scanline >= SCREEN_HEIGHT) return;
+// Redraw one 8x8 cell of a layer: one nametable, attribute and 8 pattern row fetches
+static void ppu_render_bg_tile(PPU *ppu, int layer, int tile_x, int tile_y) {
+    uint16_t nametable_base = PPU_NAMETABLE_0 + layer * 0x400;
+    uint8_t tile_index = ppu_get_nametable_tile(ppu, nametable_base, tile_x, tile_y);
+    uint8_t palette_bits = ppu_get_tile_palette_number(ppu, nametable_base, tile_x, tile_y) << 2;
+
+    for (int row = 0; row < TILE_SIZE; row++) {
+        uint64_t pixels = ppu_decode_tile_row(ppu, ppu->bg_pattern_base, tile_index, row);
+        uint8_t *dst = &ppu->bg_layer[layer][tile_y * TILE_SIZE + row][tile_x * TILE_SIZE];
+        for (int x = 0; x < TILE_SIZE; x++) {
+            uint8_t value = (pixels >> (x * 8)) & 0x03;
+            dst[x] = value ? palette_bits | value : 0;
+        }
+    }
+    ppu->bg_dirty[layer][tile_y][tile_x] = false;
+}
+
+static void ppu_refresh_bg_row(PPU *ppu, int layer, int tile_y) {
+    for (int tile_x = 0; tile_x < PPU_NAMETABLE_COLS; tile_x++) {
+        if (ppu->bg_dirty[layer][tile_y][tile_x]) {
+            ppu_render_bg_tile(ppu, layer, tile_x, tile_y);
+        }
+    }
+}
+
+// Dirty the cells whose nametable entry is a tile rewritten since the last blit
+static void ppu_mark_changed_tiles(PPU *ppu) {
+    const bool *changed = &ppu->bg_tile_changed[ppu->bg_pattern_base >> 4];
+
+    for (int layer = 0; layer < PPU_NAMETABLES; layer++) {
+        const uint8_t *nametable = &ppu->vram[layer * 0x400];
+        for (int cell = 0; cell < PPU_NAMETABLE_ROWS * PPU_NAMETABLE_COLS; cell++) {
+            if (changed[nametable[cell]]) {
+                ppu->bg_dirty[layer][cell / PPU_NAMETABLE_COLS][cell % PPU_NAMETABLE_COLS] = true;
+            }
+        }
+    }
+}
+
+// Scrolled blit from the layers: the line's scroll snapshot gives the offset
+// inside the 512x480 plane, wrapping into the neighbour nametables
+static void ppu_blit_background(PPU *ppu, uint8_t *line) {
+    uint16_t pattern_base = (ppu->ctrl & PPUCTRL_BG_PATTERN) ? 0x1000 : 0x0000;
+    if (ppu->bg_stale || pattern_base != ppu->bg_pattern_base) {
+        memset(ppu->bg_dirty, true, sizeof(ppu->bg_dirty));
+        ppu->bg_pattern_base = pattern_base;
+        ppu->bg_stale = false;
+    } else if (ppu->bg_tiles_changed) {
+        ppu_mark_changed_tiles(ppu);
+    }
+    if (ppu->bg_tiles_changed) {
+        memset(ppu->bg_tile_changed, false, sizeof(ppu->bg_tile_changed));
+        ppu->bg_tiles_changed = false;
+    }
+
+    int world_x, world_y;
+    ppu_line_origin(ppu, &world_x, &world_y);
+    int nametable_row = (world_y / SCREEN_HEIGHT) * 2;
+    int y = world_y % SCREEN_HEIGHT;
+
+    int x = 0;
+    while (x < SCREEN_WIDTH) {
+        int src_x = (world_x + x) % (SCREEN_WIDTH * 2);
+        int layer = ppu_nametable_layer(nametable_row + src_x / SCREEN_WIDTH);
+        int span = SCREEN_WIDTH - src_x % SCREEN_WIDTH;
+        if (span > SCREEN_WIDTH - x) span = SCREEN_WIDTH - x;
+
+        ppu_refresh_bg_row(ppu, layer, y / TILE_SIZE);
+        memcpy(&line[x], &ppu->bg_layer[layer][y][src_x % SCREEN_WIDTH], span);
+        x += span;
+    }
+}
+
+// === Sprites ===
+
+#define BYTES_01 0x0101010101010101ULL
+
+// One pass over OAM: each sprite is appended to the lines it covers, OAM order
+// is kept so the first entry of a line has the highest priority
+static void ppu_build_sprite_lines(PPU *ppu) {
+    int height = (ppu->ctrl & PPUCTRL_SPRITE_SIZE) ? 16 : 8;
+
+    memset(ppu->sprite_line_count, 0, sizeof(ppu->sprite_line_count));
+    memset(ppu->sprite_line_overflow, 0, sizeof(ppu->sprite_line_overflow));
+
+    for (int i = 0; i < PPU_SPRITES; i++) {
+        // Sprites show up one line below their OAM Y
+        int top = ppu->oam[i * 4] + 1;
+        for (int y = top; y < top + height && y < SCREEN_HEIGHT; y++) {
+            if (ppu->sprite_line_count[y] < PPU_SPRITES_PER_LINE) {
+                ppu->sprite_lines[y][ppu->sprite_line_count[y]++] = i;
+            } else {
+                ppu->sprite_line_overflow[y] = true;
+            }
+        }
+    }
+
+    ppu->sprite_height = height;
+    ppu->sprites_dirty = false;
+}
+
+static void ppu_update_sprite_lines(PPU *ppu) {
+    int height = (ppu->ctrl & PPUCTRL_SPRITE_SIZE) ? 16 : 8;
+    if (ppu->sprites_dirty || height != ppu->sprite_height) {
+        ppu_build_sprite_lines(ppu);
+    }
+}
+
+// Pattern cache tile holding `row` of a sprite, *row becomes the row inside it
+static uint16_t ppu_sprite_tile(PPU *ppu, const uint8_t *sprite, int *row) {
+    uint8_t tile = sprite[1];
+    uint16_t pattern_base;
+    int r = *row;
+
+    if (sprite[2] & SPRITE_ATTR_FLIP_Y) {
+        r = ppu->sprite_height - 1 - r;
+    }
+
+    if (ppu->sprite_height == 16) {
+        // 8x16: bit 0 picks the table, the bottom half is the next tile
+        pattern_base = (tile & 0x01) ? 0x1000 : 0x0000;
+        tile = (tile & 0xFE) + (r >> 3);
+    } else {
+        pattern_base = (ppu->ctrl & PPUCTRL_SPRITE_PATTERN) ? 0x1000 : 0x0000;
+    }
+
+    *row = r & 0x07;
+    return ppu_pattern_tile(ppu, pattern_base, tile);
+}
+
+// Row of a sprite as 8 pixel bytes (0-3), already flipped
+static uint64_t ppu_sprite_row(PPU *ppu, const uint8_t *sprite, int row) {
+    uint64_t pixels = ppu->pattern_cache[ppu_sprite_tile(ppu, sprite, &row)][row];
+    return (sprite[2] & SPRITE_ATTR_FLIP_X) ? __builtin_bswap64(pixels) : pixels;
+}
+
+// Merge this line's sprites into `line` (palette RAM indices, 8 bytes of slack
+// at the end), 8 pixels per step with byte masks. A sprite pixel hides the
+// sprites after it even when it is itself behind the background.
+static void ppu_render_sprites(PPU *ppu, uint8_t *line) {
     int y = ppu->scanline;
+    uint8_t drawn[SCREEN_WIDTH + TILE_SIZE] = {0};
+
+    for (int i = 0; i < ppu->sprite_line_count[y]; i++) {
+        const uint8_t *sprite = &ppu->oam[ppu->sprite_lines[y][i] * 4];
+        int x = sprite[3];
+        uint64_t pixels = ppu_sprite_row(ppu, sprite, y - (sprite[0] + 1));
+
+        // 0xFF in every byte holding an opaque pixel
+        uint64_t opaque = ((pixels | (pixels >> 1)) & BYTES_01) * 0xFF;
+        if (x < TILE_SIZE && !(ppu->mask & PPUMASK_SHOW_LEFT_SPR)) {
+            opaque = x ? opaque & (~0ULL << ((TILE_SIZE - x) * 8)) : 0;
+        }
+
+        uint64_t taken, background, dst;
+        memcpy(&taken, &drawn[x], 8);
+        memcpy(&background, &line[x], 8);
+
+        uint64_t visible = opaque & ~taken;
+        taken |= visible;
+        memcpy(&drawn[x], &taken, 8);
+
+        if (sprite[2] & SPRITE_ATTR_BEHIND_BG) {
+            visible &= ~(((background | (background >> 1)) & BYTES_01) * 0xFF);
+        }
+
+        // Sprite palettes are palette RAM $10-$1F
+        uint64_t color = pixels | (BYTES_01 * (0x10 | (sprite[2] & SPRITE_ATTR_PALETTE) << 2));
+        dst = (background & ~visible) | (color & visible);
+        memcpy(&line[x], &dst, 8);
+    }
+}
+
+// Sprites on top of the background indices, then palette lookup into the
+// framebuffer. `indices` has 8 bytes of slack for sprites hanging past x = 255.
+static void ppu_finish_line(PPU *ppu, uint8_t *indices) {
+    if (ppu->mask & PPUMASK_SHOW_SPRITES) {
+        ppu_update_sprite_lines(ppu);
+        if (ppu->sprite_line_overflow[ppu->scanline]) {
+            ppu->status |= PPUSTATUS_SPRITE_OVERFLOW;
+        }
+        ppu_render_sprites(ppu, indices);
+    }
+
+    // Palette RAM index -> 6-bit NES color for this line (grayscale keeps the
+    // luminance column only)
+    uint8_t colors[32];
+    uint8_t color_mask = (ppu->mask & PPUMASK_GRAYSCALE) ? 0x30 : 0x3F;
+    for (int i = 0; i < 16; i++) {
+        colors[i] = ppu_get_background_color(ppu, i >> 2, i & 0x03) & color_mask;
+        colors[i + 16] = ppu->palette[16 + i] & color_mask;
+    }
+    uint8_t emphasis = (ppu->mask & PPUMASK_EMPHASIS) >> PPUMASK_EMPHASIS_SHIFT;
+    ppu->line_emphasis[ppu->scanline] = emphasis;
+
+    // Direct mode: one lookup to ARGB, straight into the caller's buffer
+    if (ppu->output_argb) {
+        const uint32_t *table = &ppu->output_palette->argb[emphasis * PALETTE_COLORS];
+        uint32_t argb[32];
+        for (int i = 0; i < 32; i++) {
+            argb[i] = table[colors[i]];
+        }
+
+        uint32_t *line = (uint32_t *)((uint8_t *)ppu->output_argb + ppu->scanline * ppu->output_pitch);
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            line[x] = argb[indices[x]];
+        }
+        return;
+    }
 
+    uint8_t *line = &ppu->framebuffer[ppu->scanline * SCREEN_WIDTH];
     for (int x = 0; x < SCREEN_WIDTH; x++) {
-        int tile_x = x / TILE_SIZE;
-        int tile_y = y / TILE_SIZE;
-        int pixel_x = x % TILE_SIZE;
-        int pixel_y = y % TILE_SIZE;
+        line[x] = colors[indices[x]];
+    }
+}
 
-        uint8_t tile_index = ppu_get_nametable_tile(ppu, tile_x, tile_y);
-        uint8_t pixels[8];
-        ppu_get_tile_row(ppu, tile_index, pixel_y, pixels);
+void ppu_render_scanline(PPU *ppu) {
+    if (ppu->scanline < 0 || ppu->scanline >= SCREEN_HEIGHT) return;
 
-        uint8_t palette_num = ppu_get_tile_palette_number(ppu, tile_x, tile_y);
-        uint8_t pixel_value = pixels[pixel_x];
+    // Palette RAM index of every pixel, 0 (backdrop) where the background is hidden
+    uint8_t indices[SCREEN_WIDTH + TILE_SIZE];
+    if (ppu->mask & PPUMASK_SHOW_BG) {
+        ppu_blit_background(ppu, indices);
+        if (!(ppu->mask & PPUMASK_SHOW_LEFT_BG)) {
+            memset(indices, 0, TILE_SIZE);
+        }
+    } else {
+        memset(indices, 0, sizeof(indices));
+    }
+    ppu_finish_line(ppu, indices);
+}
 
-        uint8_t color_index = ppu_get_background_color(ppu, palette_num, pixel_value);
+// === Sprite 0 hit ===
 
-        uint8_t nes_color_index = ppu_get_background_color(ppu, palette_num, pixel_value);
-        ppu->framebuffer[y * SCREEN_WIDTH + x] = 0xFF000000 | NES_PALETTE[nes_color_index];
+// Opacity of the 8 background pixels from screen x on this line, bit 7 = x.
+// Same scrolling as ppu_blit_background, straight from the pattern masks.
+static uint8_t ppu_bg_opacity(PPU *ppu, int x) {
+    int world_x, world_y;
+    ppu_line_origin(ppu, &world_x, &world_y);
+    world_x += x;
+    int nametable_row = (world_y / SCREEN_HEIGHT) * 2;
+    int y = world_y % SCREEN_HEIGHT;
+    uint16_t pattern_base = (ppu->ctrl & PPUCTRL_BG_PATTERN) ? 0x1000 : 0x0000;
 
+    // The 8 pixels straddle two tiles
+    uint16_t masks = 0;
+    for (int i = 0; i < 2; i++) {
+        int src_x = (world_x + i * TILE_SIZE) % (SCREEN_WIDTH * 2);
+        int layer = ppu_nametable_layer(nametable_row + src_x / SCREEN_WIDTH);
+        uint8_t tile_index = ppu->vram[layer * 0x400 + (y / TILE_SIZE) * PPU_NAMETABLE_COLS + (src_x % SCREEN_WIDTH) / TILE_SIZE];
+        uint16_t tile = ppu_pattern_tile(ppu, pattern_base, tile_index);
+        masks = (masks << 8) | ppu->pattern_opacity[tile][y % TILE_SIZE];
     }
+    return (masks << (world_x % TILE_SIZE)) >> 8;
+}
+
+// Pixels of sprite 0 on this line that can hit, bit 7 = its x. The line must
+// be one sprite 0 covers.
+static uint8_t ppu_sprite0_mask(PPU *ppu) {
+    const uint8_t *sprite = &ppu->oam[0];
+    int x = sprite[3];
+    int row = ppu->scanline - (sprite[0] + 1);
+    uint8_t opaque = ppu->pattern_opacity[ppu_sprite_tile(ppu, sprite, &row)][row];
+    if (sprite[2] & SPRITE_ATTR_FLIP_X) {
+        opaque = bit_reverse[opaque];
+    }
+
+    // No hit in the clipped left 8 pixels, nor at x = 255
+    uint8_t left = PPUMASK_SHOW_LEFT_BG | PPUMASK_SHOW_LEFT_SPR;
+    if (x < TILE_SIZE && (ppu->mask & left) != left) {
+        opaque &= 0xFF >> (TILE_SIZE - x);
+    }
+    if (x > SCREEN_WIDTH - 1 - TILE_SIZE) {
+        opaque &= 0xFF << (x - (SCREEN_WIDTH - 1 - TILE_SIZE));
+    }
+    return opaque;
+}
+
+// Dot 1 of a visible line: find where sprite 0 first overlaps opaque
+// background, -1 if it does not (or not on this line)
+static int ppu_sprite0_hit_dot(PPU *ppu) {
+    if ((ppu->status & PPUSTATUS_SPRITE_0) ||
+        (ppu->mask & (PPUMASK_SHOW_BG | PPUMASK_SHOW_SPRITES)) != (PPUMASK_SHOW_BG | PPUMASK_SHOW_SPRITES)) {
+        return -1;
+    }
+
+    int y = ppu->scanline;
+    ppu_update_sprite_lines(ppu);
+    if (!ppu->sprite_line_count[y] || ppu->sprite_lines[y][0] != 0) {
+        return -1;
+    }
+
+    int x = ppu->oam[3];
+    ppu_latch_scroll(ppu);
+    uint8_t hit = ppu_sprite0_mask(ppu) & ppu_bg_opacity(ppu, x);
+    if (!hit) {
+        return -1;
+    }
+    return x + __builtin_clz(hit) - 24 + 1;  // Pixel x is output at dot x + 1
 }
 
 // === PPU Cycle ===
 
-void ppu_step(PPU *ppu) {
+static inline void ppu_next_dot(PPU *ppu) {
     ppu->cycle++;
     
     // 341 cycles per scanline
@@ -295,43 +742,328 @@ void ppu_step(PPU *ppu) {
             ppu->frame_count++;
         }
     }
+}
+
+// Pre-render scanline (-1), dot 1
+static void ppu_clear_flags(PPU *ppu) {
+    ppu->status &= ~PPUSTATUS_VBLANK;
+    ppu->status &= ~PPUSTATUS_SPRITE_0;
+    ppu->status &= ~PPUSTATUS_SPRITE_OVERFLOW;
+}
+
+// Scanline 241, dot 1
+static void ppu_vblank(PPU *ppu) {
+    ppu->status |= PPUSTATUS_VBLANK;
+    ppu->draw_flag = true;
+    
+    // Déclencher NMI si activé
+    if ((ppu->ctrl & PPUCTRL_NMI_ENABLE) && ppu->nmi_callback) {
+        ppu->nmi_callback(ppu->nmi_context);
+    }
+}
+
+void ppu_step(PPU *ppu) {
+    ppu_next_dot(ppu);
     
     // Pre-render scanline (-1)
-    if (ppu->scanline == -1) {
-        if (ppu->cycle == 1) {
-            ppu->status &= ~PPUSTATUS_VBLANK;
-            ppu->status &= ~PPUSTATUS_SPRITE_0;
-            ppu->status &= ~PPUSTATUS_SPRITE_OVERFLOW;
-        }
+    if (ppu->scanline == -1 && ppu->cycle == 1) {
+        ppu_clear_flags(ppu);
     }
     
     // Scanlines visibles (0-239)
     if (ppu->scanline >= 0 && ppu->scanline < 240) {
-        // TODO: render pixel per pixel
+        if (ppu->cycle == 1) {
+            ppu->sprite0_dot = ppu_sprite0_hit_dot(ppu);
+        }
+        if (ppu->cycle == ppu->sprite0_dot) {
+            ppu->status |= PPUSTATUS_SPRITE_0;
+            ppu->sprite0_dot = -1;
+        }
+
+        // Whole line at once with the scroll it started with, see the accurate
+        // tier for pixel per pixel. Then dots 256-257 for v: next row, X from t.
         if (ppu->cycle == 256) {
+            ppu_latch_scroll(ppu);
             ppu_render_scanline(ppu);
+            if (ppu_rendering(ppu)) {
+                ppu_increment_y(ppu);
+                ppu->addr = (ppu->addr & ~0x041F) | (ppu->temp_addr & 0x041F);
+            }
         }
     }
+
+    // Pre-render dots 257-304 copy t to v: scroll written during vblank
+    if (ppu->scanline == -1 && ppu->cycle == 304 && ppu_rendering(ppu)) {
+        ppu->addr = ppu->temp_addr;
+    }
     
     // Post-render scanline (240)
     // Nothing to do :-)
 
     // VBlank scanlines (241-260)
     if (ppu->scanline == 241 && ppu->cycle == 1) {
-        ppu->status |= PPUSTATUS_VBLANK;
-        ppu->draw_flag = true;
-        
-        // Déclencher NMI si activé
-        if ((ppu->ctrl & PPUCTRL_NMI_ENABLE) && ppu->nmi_callback) {
-            ppu->nmi_callback();
+        ppu_vblank(ppu);
+    }
+}
+
+// Dot positions inside a frame: (scanline + 1) * 341 + cycle, the pre-render line is 0
+#define PPU_DOT(scanline, cycle) (((scanline) + 1) * PPU_DOTS_PER_LINE + (cycle))
+
+// Next sprite 0 event after pos: the pending hit on this line, else dot 1 of the
+// next line sprite 0 covers. INT_MAX when no hit can happen this frame.
+static int ppu_sprite0_event(PPU *ppu, int pos) {
+    // Checked first: the hit lands even if rendering is turned off meanwhile
+    if (ppu->sprite0_dot > 0 && pos < PPU_DOT(ppu->scanline, ppu->sprite0_dot)) {
+        return PPU_DOT(ppu->scanline, ppu->sprite0_dot);
+    }
+    if ((ppu->status & PPUSTATUS_SPRITE_0) ||
+        (ppu->mask & (PPUMASK_SHOW_BG | PPUMASK_SHOW_SPRITES)) != (PPUMASK_SHOW_BG | PPUMASK_SHOW_SPRITES)) {
+        return INT_MAX;
+    }
+
+    int top = ppu->oam[0] + 1;
+    int bottom = top + ((ppu->ctrl & PPUCTRL_SPRITE_SIZE) ? 16 : 8);
+    for (int line = top; line < bottom && line < SCREEN_HEIGHT; line++) {
+        if (pos < PPU_DOT(line, 1)) {
+            return PPU_DOT(line, 1);
+        }
+    }
+    return INT_MAX;
+}
+
+// Next fixed event after pos, as a dot position (may be in the next frame)
+static int ppu_next_event(PPU *ppu, int pos) {
+    int line = ppu->scanline;
+
+    if (pos < PPU_DOT(-1, 1)) {
+        return PPU_DOT(-1, 1);  // Clear vblank
+    }
+    if (pos < PPU_DOT(-1, 304)) {
+        return PPU_DOT(-1, 304);  // v = t
+    }
+    if (line >= 0 && line < SCREEN_HEIGHT && pos < PPU_DOT(line, 256)) {
+        return PPU_DOT(line, 256);  // Render this line
+    }
+    if (line < SCREEN_HEIGHT - 1) {
+        return PPU_DOT(line + 1, 256);  // Render the next line
+    }
+    if (pos < PPU_DOT(241, 1)) {
+        return PPU_DOT(241, 1);  // Vblank + NMI
+    }
+    return PPU_DOTS_PER_LINE * PPU_LINES_PER_FRAME + PPU_DOT(-1, 1);
+}
+
+static int ppu_fast_dots_until_event(PPU *ppu) {
+    int pos = PPU_DOT(ppu->scanline, ppu->cycle);
+    int next = ppu_next_event(ppu, pos);
+    int sprite0 = ppu_sprite0_event(ppu, pos);
+    return (sprite0 < next ? sprite0 : next) - pos;
+}
+
+// Move `dots` dots ahead without running them: only valid when none is an event
+static void ppu_skip(PPU *ppu, int dots) {
+    int pos = PPU_DOT(ppu->scanline, ppu->cycle) + dots;
+    while (pos >= PPU_DOTS_PER_LINE * PPU_LINES_PER_FRAME) {
+        pos -= PPU_DOTS_PER_LINE * PPU_LINES_PER_FRAME;
+        ppu->frame_count++;
+    }
+    ppu->scanline = pos / PPU_DOTS_PER_LINE - 1;
+    ppu->cycle = pos % PPU_DOTS_PER_LINE;
+}
+
+static void ppu_fast_run(PPU *ppu, int dots) {
+    while (dots > 0) {
+        int until = ppu_fast_dots_until_event(ppu);
+        if (until > dots) {
+            ppu_skip(ppu, dots);
+            return;
+        }
+        ppu_skip(ppu, until - 1);
+        ppu_step(ppu);  // The event dot itself
+        dots -= until;
+    }
+}
+
+// === Accurate tier ===
+// The real background fetch pipeline, one dot at a time on the rendering lines:
+// loopy v (addr) / t (temp_addr) / x (fine_x) scrolling, 16-bit shift registers,
+// so mid-line PPUSCROLL/PPUADDR/PPUCTRL writes land on the exact pixel, and
+// sprite 0 hit is raised while the pixel is produced. Sprites are still merged
+// per line from the sprite lists at dot 256.
+
+static void ppu_load_shifters(PPU *ppu) {
+    ppu->bg_shift_lo = (ppu->bg_shift_lo & 0xFF00) | ppu->next_lo;
+    ppu->bg_shift_hi = (ppu->bg_shift_hi & 0xFF00) | ppu->next_hi;
+    ppu->at_shift_lo = (ppu->at_shift_lo & 0xFF00) | ((ppu->next_attrib & 0x01) ? 0xFF : 0x00);
+    ppu->at_shift_hi = (ppu->at_shift_hi & 0xFF00) | ((ppu->next_attrib & 0x02) ? 0xFF : 0x00);
+}
+
+// One step of the 8-dot fetch cycle: nametable, attribute, pattern low/high
+static void ppu_fetch(PPU *ppu, int step) {
+    uint16_t v = ppu->addr;
+
+    switch (step) {
+        case 0:
+            ppu_load_shifters(ppu);
+            ppu->next_tile = ppu_read_memory(ppu, 0x2000 | (v & 0x0FFF));
+            break;
+        case 2: {
+            uint8_t attrib = ppu_read_memory(ppu, 0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+            if (v & 0x0040) attrib >>= 4;  // Bottom half (coarse Y bit 1)
+            if (v & 0x0002) attrib >>= 2;  // Right half (coarse X bit 1)
+            ppu->next_attrib = attrib & 0x03;
+            break;
+        }
+        case 4:
+        case 6: {
+            uint16_t pattern_base = (ppu->ctrl & PPUCTRL_BG_PATTERN) ? 0x1000 : 0x0000;
+            uint16_t addr = pattern_base + ppu->next_tile * 16 + ((v >> 12) & 0x07);
+            if (step == 4) ppu->next_lo = ppu_read_memory(ppu, addr);
+            else ppu->next_hi = ppu_read_memory(ppu, addr + 8);
+            break;
         }
+        case 7:
+            ppu_increment_x(ppu);
+            break;
+    }
+}
+
+static void ppu_accurate_pixel(PPU *ppu, int x) {
+    uint8_t index = 0;
+
+    if ((ppu->mask & PPUMASK_SHOW_BG) && (x >= TILE_SIZE || (ppu->mask & PPUMASK_SHOW_LEFT_BG))) {
+        uint16_t bit = 0x8000 >> ppu->fine_x;
+        uint8_t value = ((ppu->bg_shift_lo & bit) ? 1 : 0) | ((ppu->bg_shift_hi & bit) ? 2 : 0);
+        if (value) {
+            uint8_t palette_num = ((ppu->at_shift_lo & bit) ? 1 : 0) | ((ppu->at_shift_hi & bit) ? 2 : 0);
+            index = (palette_num << 2) | value;
+        }
+    }
+    ppu->line_indices[x] = index;
+
+    int offset = x - ppu->sprite0_x;
+    if (index && offset >= 0 && offset < TILE_SIZE && (ppu->sprite0_mask & (0x80 >> offset)) &&
+        (ppu->mask & PPUMASK_SHOW_SPRITES)) {
+        ppu->status |= PPUSTATUS_SPRITE_0;
+        ppu->sprite0_mask = 0;
     }
 }
 
+static void ppu_accurate_dot(PPU *ppu) {
+    ppu_next_dot(ppu);
+    int line = ppu->scanline;
+    int dot = ppu->cycle;
+
+    if (line == -1 && dot == 1) {
+        ppu_clear_flags(ppu);
+    }
+
+    if (line < SCREEN_HEIGHT) {
+        if (ppu_rendering(ppu)) {
+            if ((dot >= 2 && dot <= 257) || (dot >= 321 && dot <= 337)) {
+                ppu->bg_shift_lo <<= 1;
+                ppu->bg_shift_hi <<= 1;
+                ppu->at_shift_lo <<= 1;
+                ppu->at_shift_hi <<= 1;
+                ppu_fetch(ppu, (dot - 1) & 0x07);
+            }
+            if (dot == 256) {
+                ppu_increment_y(ppu);
+            }
+            if (dot == 257) {
+                ppu_load_shifters(ppu);
+                ppu->addr = (ppu->addr & ~0x041F) | (ppu->temp_addr & 0x041F);  // Copy X
+            }
+            if (line == -1 && dot >= 280 && dot <= 304) {
+                ppu->addr = (ppu->addr & ~0x7BE0) | (ppu->temp_addr & 0x7BE0);  // Copy Y
+            }
+        }
+
+        if (line >= 0 && dot >= 1 && dot <= 256) {
+            if (dot == 1) {
+                // Sprite 0 pixels that can hit on this line, checked per pixel
+                ppu->sprite0_mask = 0;
+                ppu->sprite0_x = ppu->oam[3];
+                if (!(ppu->status & PPUSTATUS_SPRITE_0) && (ppu->mask & PPUMASK_SHOW_SPRITES)) {
+                    ppu_update_sprite_lines(ppu);
+                    if (ppu->sprite_line_count[line] && ppu->sprite_lines[line][0] == 0) {
+                        ppu->sprite0_mask = ppu_sprite0_mask(ppu);
+                    }
+                }
+            }
+            ppu_accurate_pixel(ppu, dot - 1);
+            if (dot == 256) {
+                ppu_finish_line(ppu, ppu->line_indices);
+            }
+        }
+    }
+
+    if (line == 241 && dot == 1) {
+        ppu_vblank(ppu);
+    }
+}
+
+static int ppu_accurate_dots_until_event(PPU *ppu) {
+    // Status flags are only seen through $2002, which catches up first: the
+    // vblank edge (NMI, frame done) is the only event
+    int pos = PPU_DOT(ppu->scanline, ppu->cycle);
+    int vblank = PPU_DOT(241, 1);
+    return pos < vblank ? vblank - pos : PPU_DOTS_PER_LINE * PPU_LINES_PER_FRAME + vblank - pos;
+}
+
+static void ppu_accurate_run(PPU *ppu, int dots) {
+    while (dots > 0) {
+        if (ppu->scanline >= SCREEN_HEIGHT) {
+            // Lines 240-260: nothing but the vblank edge until the pre-render line
+            int pos = PPU_DOT(ppu->scanline, ppu->cycle);
+            int next = pos < PPU_DOT(241, 1) ? PPU_DOT(241, 1) : PPU_DOTS_PER_LINE * PPU_LINES_PER_FRAME + PPU_DOT(-1, 1);
+            int idle = next - pos - 1;
+            if (idle >= dots) {
+                ppu_skip(ppu, dots);
+                return;
+            }
+            ppu_skip(ppu, idle);
+            dots -= idle;
+        }
+        ppu_accurate_dot(ppu);
+        dots--;
+    }
+}
+
+// === Accuracy tiers ===
+
+static const PpuTierOps ppu_tiers[PPU_TIER_COUNT] = {
+    [PPU_TIER_FAST]     = { "fast",     ppu_fast_run,     ppu_fast_dots_until_event },
+    [PPU_TIER_ACCURATE] = { "accurate", ppu_accurate_run, ppu_accurate_dots_until_event },
+};
+
+void ppu_set_tier(PPU *ppu, PpuTier tier) {
+    ppu->tier = &ppu_tiers[tier];
+    ppu->sprite0_dot = -1;
+    ppu->sprite0_mask = 0;
+}
+
+void ppu_run(PPU *ppu, int dots) {
+    ppu->tier->run(ppu, dots);
+}
+
+int ppu_dots_until_event(PPU *ppu) {
+    return ppu->tier->dots_until_event(ppu);
+}
+
+// === Output ===
+
+void ppu_set_output_argb(PPU *ppu, uint32_t *pixels, int pitch, const PaletteLut *palette) {
+    ppu->output_argb = pixels;
+    ppu->output_pitch = pitch;
+    ppu->output_palette = palette;
+}
+
 // === Callbacks ===
 
-void ppu_set_nmi_callback(PPU *ppu, void (*callback)(void)) {
+void ppu_set_nmi_callback(PPU *ppu, PpuNmiCallback callback, void *context) {
     ppu->nmi_callback = callback;
+    ppu->nmi_context = context;
 }
 
 // === Utils ===
@@ -365,4 +1097,36 @@ void ppu_dump_oam(PPU *ppu) {
                    i, y, x, tile, attr);
         }
     }
-}
\ No newline at end of file
+}
+
+// === Instrumentation ===
+
+PpuRegion ppu_region(uint16_t addr) {
+    addr &= 0x3FFF;
+    if (addr < 0x2000) return PPU_REGION_PATTERN;
+    if (addr >= 0x3F00) return PPU_REGION_PALETTE;
+    return (addr & 0x03FF) >= 0x03C0 ? PPU_REGION_ATTRIBUTE : PPU_REGION_NAMETABLE;
+}
+
+const char *ppu_region_name(PpuRegion region) {
+    static const char *names[PPU_REGION_COUNT] = { "pattern", "nametable", "attribute", "palette" };
+    return region < PPU_REGION_COUNT ? names[region] : "?";
+}
+
+void ppu_stats_reset(PPU *ppu) {
+    uint32_t log_every = ppu->stats.log_every;
+    memset(&ppu->stats, 0, sizeof(ppu->stats));
+    ppu->stats.log_every = log_every;
+}
+
+void ppu_dump_stats(PPU *ppu) {
+    printf("=== PPU accesses ===\n");
+#ifndef PPU_STATS
+    printf("  (build with PPU_STATS=1 to count them)\n");
+#endif
+    for (int region = 0; region < PPU_REGION_COUNT; region++) {
+        printf("  %-10s reads: %10llu  writes: %10llu\n", ppu_region_name(region),
+               (unsigned long long)ppu->stats.reads[region],
+               (unsigned long long)ppu->stats.writes[region]);
+    }
+}
@@ -0,0 +1,72 @@
+#include <string.h>
+#include "../includes/scheduler.h"
+
+void scheduler_init(Scheduler *sched) {
+    memset(sched, 0, sizeof(Scheduler));
+    memset(sched->slot, -1, sizeof(sched->slot));
+}
+
+void scheduler_set_handler(Scheduler *sched, SchedEventId id, SchedHandler handler) {
+    sched->handler[id] = handler;
+}
+
+static void scheduler_place(Scheduler *sched, int index, SchedEntry entry) {
+    sched->heap[index] = entry;
+    sched->slot[entry.id] = index;
+}
+
+// Move the entry at index up or down until the heap order holds again
+static void scheduler_fix(Scheduler *sched, int index) {
+    SchedEntry entry = sched->heap[index];
+
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (sched->heap[parent].time <= entry.time) break;
+        scheduler_place(sched, index, sched->heap[parent]);
+        index = parent;
+    }
+
+    for (;;) {
+        int child = index * 2 + 1;
+        if (child >= sched->count) break;
+        if (child + 1 < sched->count && sched->heap[child + 1].time < sched->heap[child].time) {
+            child++;
+        }
+        if (entry.time <= sched->heap[child].time) break;
+        scheduler_place(sched, index, sched->heap[child]);
+        index = child;
+    }
+
+    scheduler_place(sched, index, entry);
+}
+
+void scheduler_schedule(Scheduler *sched, SchedEventId id, uint64_t time) {
+    int index = sched->slot[id];
+    if (index < 0) {
+        index = sched->count++;
+    }
+    sched->heap[index] = (SchedEntry){ .time = time, .id = id };
+    scheduler_fix(sched, index);
+}
+
+void scheduler_cancel(Scheduler *sched, SchedEventId id) {
+    int index = sched->slot[id];
+    if (index < 0) return;
+
+    sched->slot[id] = -1;
+    if (--sched->count > index) {
+        sched->heap[index] = sched->heap[sched->count];
+        scheduler_fix(sched, index);
+    }
+}
+
+void scheduler_run_due(Scheduler *sched, struct CPU *nes, uint64_t now) {
+    while (sched->count && sched->heap[0].time <= now) {
+        SchedEntry entry = sched->heap[0];
+        scheduler_cancel(sched, entry.id);  // The handler re-arms it if needed
+        sched->dispatched++;
+        if (sched->handler[entry.id]) {
+            sched->handler[entry.id](nes, entry.time);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include "../includes/trace.h"
+
+// Write everything between tail and head, in at most two contiguous chunks
+static void trace_drain(Trace *trace) {
+    uint64_t tail = atomic_load_explicit(&trace->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&trace->head, memory_order_acquire);
+
+    while (tail != head) {
+        uint64_t start = tail & (TRACE_RING_SIZE - 1);
+        uint64_t count = head - tail;
+        if (start + count > TRACE_RING_SIZE) {
+            count = TRACE_RING_SIZE - start;
+        }
+
+        fwrite(&trace->ring[start], sizeof(TraceRecord), count, trace->file);
+        tail += count;
+        atomic_store_explicit(&trace->tail, tail, memory_order_release);
+    }
+}
+
+static void *trace_writer_thread(void *arg) {
+    Trace *trace = arg;
+    const struct timespec idle = { 0, 1000000 };  // 1 ms
+
+    while (atomic_load_explicit(&trace->running, memory_order_acquire)) {
+        if (atomic_load_explicit(&trace->head, memory_order_acquire) ==
+            atomic_load_explicit(&trace->tail, memory_order_relaxed)) {
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        trace_drain(trace);
+    }
+
+    trace_drain(trace);
+    return NULL;
+}
+
+int trace_open(Trace *trace, const char *path) {
+    memset(trace, 0, sizeof(Trace));
+
+    trace->file = fopen(path, "wb");
+    if (!trace->file) {
+        fprintf(stderr, "❌ Cannot open trace file %s\n", path);
+        return 1;
+    }
+
+    trace->ring = malloc(sizeof(TraceRecord) * TRACE_RING_SIZE);
+    if (!trace->ring) {
+        fprintf(stderr, "❌ Cannot allocate trace ring\n");
+        fclose(trace->file);
+        return 1;
+    }
+
+    TraceHeader header = { .version = TRACE_VERSION, .record_size = sizeof(TraceRecord) };
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, trace->file);
+
+    atomic_store(&trace->running, true);
+    if (pthread_create(&trace->writer, NULL, trace_writer_thread, trace) != 0) {
+        fprintf(stderr, "❌ Cannot start trace writer thread\n");
+        free(trace->ring);
+        fclose(trace->file);
+        return 1;
+    }
+
+    printf("✅ CPU trace enabled: %s\n", path);
+    return 0;
+}
+
+void trace_close(Trace *trace) {
+    if (!trace->file) return;
+
+    atomic_store(&trace->running, false);
+    pthread_join(trace->writer, NULL);
+
+    fclose(trace->file);
+    free(trace->ring);
+    trace->file = NULL;
+    trace->ring = NULL;
+
+    printf("✅ CPU trace closed (%llu records, %llu stalls)\n",
+           (unsigned long long)atomic_load(&trace->head),
+           (unsigned long long)trace->stalls);
+}
+
+// Slow path: the writer fell behind, give it the CPU until a slot frees up
+void trace_wait_for_space(Trace *trace) {
+    trace->stalls++;
+    while (atomic_load_explicit(&trace->head, memory_order_relaxed) -
+           atomic_load_explicit(&trace->tail, memory_order_acquire) >= TRACE_RING_SIZE) {
+        sched_yield();
+    }
+}
@@ -0,0 +1,31 @@
+#include <string.h>
+#include "../includes/triple_buffer.h"
+
+void triple_buffer_init(TripleBuffer *buffer) {
+    memset(buffer->frames, 0, sizeof(buffer->frames));
+    buffer->back = 0;
+    atomic_store(&buffer->middle, 1);
+    buffer->front = 2;
+}
+
+Frame *triple_buffer_back(TripleBuffer *buffer) {
+    return &buffer->frames[buffer->back];
+}
+
+void triple_buffer_publish(TripleBuffer *buffer) {
+    // Release: the pixels are visible before the index is
+    uint8_t previous = atomic_exchange_explicit(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH,
+                                                memory_order_acq_rel);
+    buffer->back = previous & 0x03;
+}
+
+const Frame *triple_buffer_acquire(TripleBuffer *buffer) {
+    if (!(atomic_load_explicit(&buffer->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH)) {
+        return NULL;
+    }
+
+    // Only the producer sets FRESH, so it is still set here
+    uint8_t previous = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+    buffer->front = previous & 0x03;
+    return &buffer->frames[buffer->front];
+}
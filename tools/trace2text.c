@@ -0,0 +1,95 @@
+// trace2text - decode a binary CPU trace (see includes/trace.h) into nestest-style text
+//
+// Usage: trace2text <trace file> [output file]
+
+#include <stdio.h>
+#include <string.h>
+#include "../includes/opcodes.h"
+#include "../includes/trace.h"
+
+static void disassemble(const TraceRecord *r, char *out, size_t size) {
+    const Opcode *op = &opcode_table[r->opcode];
+    uint8_t lo = r->operand[0];
+    uint16_t abs = r->operand[0] | (r->operand[1] << 8);
+
+    switch (op->mode) {
+        case AM_IMP: snprintf(out, size, "%s", op->name); break;
+        case AM_ACC: snprintf(out, size, "%s A", op->name); break;
+        case AM_IMM: snprintf(out, size, "%s #$%02X", op->name, lo); break;
+        case AM_ZP:  snprintf(out, size, "%s $%02X", op->name, lo); break;
+        case AM_ZPX: snprintf(out, size, "%s $%02X,X", op->name, lo); break;
+        case AM_ZPY: snprintf(out, size, "%s $%02X,Y", op->name, lo); break;
+        case AM_ABS: snprintf(out, size, "%s $%04X", op->name, abs); break;
+        case AM_ABX: snprintf(out, size, "%s $%04X,X", op->name, abs); break;
+        case AM_ABY: snprintf(out, size, "%s $%04X,Y", op->name, abs); break;
+        case AM_IND: snprintf(out, size, "%s ($%04X)", op->name, abs); break;
+        case AM_IZX: snprintf(out, size, "%s ($%02X,X)", op->name, lo); break;
+        case AM_IZY: snprintf(out, size, "%s ($%02X),Y", op->name, lo); break;
+        case AM_REL: snprintf(out, size, "%s $%04X", op->name,
+                              (uint16_t)(r->pc + 2 + (int8_t)lo)); break;
+        default:     snprintf(out, size, "%s", op->name); break;
+    }
+}
+
+// nestest marks undocumented opcodes with '*'
+static bool is_illegal(uint8_t opcode) {
+    const Opcode *op = &opcode_table[opcode];
+    if (op->op >= OP_ALR) return true;
+    if (op->op == OP_NOP && opcode != 0xEA) return true;
+    return opcode == 0xEB;  // SBC #imm alias
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <trace file> [output file]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "❌ Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (argc > 2) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            fprintf(stderr, "❌ Cannot open %s\n", argv[2]);
+            fclose(in);
+            return 1;
+        }
+    }
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION ||
+        header.record_size != sizeof(TraceRecord)) {
+        fprintf(stderr, "❌ Not a CPU trace (or wrong version): %s\n", argv[1]);
+        fclose(in);
+        if (out != stdout) fclose(out);
+        return 1;
+    }
+
+    TraceRecord r;
+    while (fread(&r, sizeof(r), 1, in) == 1) {
+        uint8_t size = addr_mode_size[opcode_table[r.opcode].mode];
+        char bytes[16];
+        char text[40];
+
+        if (size == 0)      snprintf(bytes, sizeof(bytes), "%02X", r.opcode);
+        else if (size == 1) snprintf(bytes, sizeof(bytes), "%02X %02X", r.opcode, r.operand[0]);
+        else                snprintf(bytes, sizeof(bytes), "%02X %02X %02X", r.opcode, r.operand[0], r.operand[1]);
+
+        disassemble(&r, text, sizeof(text));
+
+        fprintf(out, "%04X  %-9s%c%-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n",
+                r.pc, bytes, is_illegal(r.opcode) ? '*' : ' ', text,
+                r.a, r.x, r.y, r.p, r.sp, (unsigned long long)r.cycle);
+    }
+
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return 0;
+}